@@ -230,6 +230,9 @@ AZX_LOG_LEVEL_E azx_log_getLevel(void);
  * @param max_size_kb The maximum size in KB of each size of the log file. Once the file reaches
  * that limit, no further logging will be made to it.
  *
+ * Logs are cached in RAM, in two halves; once a half is full it is written to the file by a
+ * low-priority task while the other one is being filled.
+ *
  * @return TRUE if the file can be created and opened, FALSE otherwise
  */
 BOOLEAN azx_log_send_to_file(const CHAR* filename, UINT32 circular_chunks,
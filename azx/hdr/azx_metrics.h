@@ -0,0 +1,117 @@
+#ifndef HDR_AZX_METRICS_H_
+#define HDR_AZX_METRICS_H_
+/**
+ * @file azx_metrics.h
+ * @version 1.0.0
+ * @dependencies core/azx_log
+ * @date 19/10/2026
+ *
+ * @brief Runtime metrics registry
+ *
+ * Counters, gauges and fixed-bucket histograms that the application and the
+ * azx libraries report into, independently of the log level.
+ *
+ * Metrics are registered once (typically from an init function) and the
+ * returned handle is kept by the caller. Updates through the handle are
+ * lock-free atomic operations, so they are cheap enough for hot paths.
+ * Every update function accepts a NULL handle and does nothing, so a full
+ * registry never breaks the caller.
+ */
+#include "m2mb_types.h"
+
+/** @cond DEV*/
+#ifndef AZX_METRICS_MAX
+#define AZX_METRICS_MAX 48          /**< Maximum number of registered metrics */
+#endif
+/** @endcond */
+
+/**
+ * @brief Number of histogram buckets
+ *
+ * Bucket 0 counts the value 0, bucket i (1..14) counts values in
+ * [2^(i-1), 2^i - 1] and the last bucket counts everything from 2^14 up.
+ */
+#define AZX_METRICS_HIST_BUCKETS 16
+
+/**
+ * @brief Metric kinds
+ */
+typedef enum
+{
+  AZX_METRIC_COUNTER,   /**< Monotonic counter */
+  AZX_METRIC_GAUGE,     /**< Last value set */
+  AZX_METRIC_HISTOGRAM  /**< Distribution of observed values */
+} AZX_METRIC_TYPE_E;
+
+/**
+ * @brief A registered metric
+ *
+ * The fields are public so a snapshot can be read without a function call
+ * per value, but must only be updated through the functions below.
+ */
+typedef struct
+{
+  const CHAR *name;
+  AZX_METRIC_TYPE_E type;
+  volatile UINT32 value;   /**< Counter/gauge value, number of samples for histograms */
+  volatile UINT32 sum;     /**< Histograms only: sum of the observed values */
+  volatile UINT32 max;     /**< Histograms only: largest observed value */
+  volatile UINT32 buckets[AZX_METRICS_HIST_BUCKETS];
+} AZX_METRIC_T;
+
+/**
+ * @brief Registers a metric, or returns the existing one with the same name
+ *
+ * @param[in] name The metric name. Must be a string literal, only the pointer is stored.
+ * @param[in] type The metric kind
+ *
+ * @return The metric handle, NULL if the registry is full
+ */
+AZX_METRIC_T* azx_metrics_register(const CHAR *name, AZX_METRIC_TYPE_E type);
+
+/**
+ * @brief Adds to a counter (or a gauge)
+ *
+ * @param[in] m The metric handle
+ * @param[in] n The amount to add
+ */
+void azx_metrics_add(AZX_METRIC_T *m, UINT32 n);
+
+/**
+ * @brief Sets a gauge
+ *
+ * @param[in] m The metric handle
+ * @param[in] v The new value
+ */
+void azx_metrics_set(AZX_METRIC_T *m, UINT32 v);
+
+/**
+ * @brief Records a sample in a histogram
+ *
+ * @param[in] m The metric handle
+ * @param[in] v The observed value, in the unit chosen by the caller (e.g. ms, bytes)
+ */
+void azx_metrics_observe(AZX_METRIC_T *m, UINT32 v);
+
+/**
+ * @brief Takes a snapshot of the registry
+ *
+ * Each metric is copied as a whole, so the snapshot can be exported at
+ * leisure while the live values keep changing.
+ *
+ * @param[out] out Array receiving the metrics
+ * @param[in] max_count Number of elements in out
+ *
+ * @return The number of metrics copied
+ */
+UINT32 azx_metrics_snapshot(AZX_METRIC_T *out, UINT32 max_count);
+
+/**
+ * @brief Prints all the metrics on the log, one line each
+ */
+void azx_metrics_log(void);
+
+/** @brief Shorthand to increment a counter by one */
+#define AZX_METRICS_INC(m) azx_metrics_add(m, 1)
+
+#endif /* HDR_AZX_METRICS_H_ */
@@ -0,0 +1,86 @@
+#ifndef HDR_AZX_REACTOR_H_
+#define HDR_AZX_REACTOR_H_
+/**
+ * @file azx_reactor.h
+ * @version 1.0.0
+ * @dependencies core/azx_log core/azx_utils
+ * @date 19/10/2026
+ *
+ * @brief Event loop shared by the event sources of the application
+ *
+ * A single "AzxReactor" task multiplexes all the registered sources and
+ * dispatches their events to short, non-blocking handlers, so sources that
+ * only need a little work on each event do not need a task (and a stack) of
+ * their own.
+ *
+ * A source raises events in one of two ways:
+ * - azx_reactor_signal() sets the event flag of the source: repeated signals
+ *   before dispatch are coalesced into one handler call, and signalling never
+ *   fails. Suited to "something changed, go and look" events (timer ticks,
+ *   coroutine wake-ups).
+ * - azx_reactor_post() queues an argument: every post gets its own handler
+ *   call, in order. Suited to events that carry data (which input fired).
+ *
+ * Both can be called from interrupt and timer callbacks. Handlers run one at
+ * a time on the reactor task: signals first, in registration order, then the
+ * queued posts. The run time of each handler goes to the reactor.handler_us
+ * histogram, to spot handlers that block.
+ */
+#include "m2mb_types.h"
+
+/** @cond DEV*/
+#ifndef AZX_REACTOR_MAX_SOURCES
+#define AZX_REACTOR_MAX_SOURCES 16   /**< Maximum number of sources, at most 31 */
+#endif
+
+#ifndef AZX_REACTOR_QUEUE_LEN
+#define AZX_REACTOR_QUEUE_LEN 32     /**< Posts that can wait for dispatch */
+#endif
+/** @endcond */
+
+/**
+ * @brief Event handler
+ *
+ * @param[in] arg The posted argument, 0 for a signal
+ * @param[in] ctx The context given to azx_reactor_add()
+ */
+typedef void (*azx_reactor_handler)(UINT32 arg, void *ctx);
+
+/**
+ * @brief Starts the reactor task
+ *
+ * Called implicitly by azx_reactor_add(); calling it again does nothing.
+ *
+ * @return TRUE if the reactor is running
+ */
+BOOLEAN azx_reactor_init(void);
+
+/**
+ * @brief Registers an event source
+ *
+ * @param[in] name The source name, for the logs. Only the pointer is stored.
+ * @param[in] handler The handler called on the reactor task for each event
+ * @param[in] ctx Context passed to the handler
+ *
+ * @return The source id, -1 if the reactor cannot be started or is full
+ */
+INT32 azx_reactor_add(const CHAR *name, azx_reactor_handler handler, void *ctx);
+
+/**
+ * @brief Signals a source; coalesced with the pending signals of the same source
+ *
+ * @param[in] src The source id
+ */
+void azx_reactor_signal(INT32 src);
+
+/**
+ * @brief Queues an event with an argument for a source
+ *
+ * @param[in] src The source id
+ * @param[in] arg The argument for the handler
+ *
+ * @return FALSE if the queue is full; the drop is counted in reactor.dropped
+ */
+BOOLEAN azx_reactor_post(INT32 src, UINT32 arg);
+
+#endif /* HDR_AZX_REACTOR_H_ */
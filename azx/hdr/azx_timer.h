@@ -0,0 +1,104 @@
+#ifndef HDR_AZX_TIMER_H_
+#define HDR_AZX_TIMER_H_
+/**
+ * @file azx_timer.h
+ * @version 1.0.0
+ * @dependencies core/azx_log core/azx_utils core/azx_reactor
+ * @date 19/10/2026
+ *
+ * @brief Hashed timer wheel for cheap software timeouts
+ *
+ * A single periodic m2mb_os_tmr advances a wheel of @ref AZX_TIMER_WHEEL_SLOTS
+ * slots every @ref AZX_TIMER_TICK_MS. Timers are embedded in the caller's own
+ * structures, so any number of them can be pending without allocation, and
+ * starting or cancelling one is O(1). Expired callbacks run one at a time on
+ * the reactor task (azx_reactor.h), never in timer or interrupt context, so
+ * they may post messages or restart their own timer, but must not block.
+ *
+ * The OS timer only runs while at least one timer is pending.
+ *
+ * Use it for timeouts measured in tens of milliseconds or more (deadlines,
+ * retry backoffs, idle and housekeeping timers); sub-tick delays belong to
+ * m2mb_hwTmr or azx_delay_us().
+ */
+#include "m2mb_types.h"
+
+/** @cond DEV*/
+#ifndef AZX_TIMER_TICK_MS
+#define AZX_TIMER_TICK_MS 10          /**< Wheel resolution, in milliseconds */
+#endif
+
+#ifndef AZX_TIMER_WHEEL_SLOTS
+#define AZX_TIMER_WHEEL_SLOTS 128     /**< Number of slots, a power of 2 */
+#endif
+/** @endcond */
+
+/**
+ * @brief Timer callback, called on the reactor task
+ *
+ * @param[in] arg The argument given to azx_timer_start()
+ */
+typedef void (*azx_timer_cb)(void *arg);
+
+/**
+ * @brief A timer
+ *
+ * Owned by the caller, who must keep it alive while it is pending. Zero it
+ * (or declare it static) before first use; the fields are private.
+ */
+typedef struct AZX_TIMER_S
+{
+  struct AZX_TIMER_S *next;
+  struct AZX_TIMER_S *prev;
+  UINT32 rounds;
+  azx_timer_cb cb;
+  void *arg;
+} AZX_TIMER_T;
+
+/**
+ * @brief Starts the wheel, and the reactor if needed
+ *
+ * Called implicitly by azx_timer_start(); calling it again does nothing.
+ *
+ * @return TRUE if the wheel is running
+ */
+BOOLEAN azx_timer_init(void);
+
+/**
+ * @brief Starts (or restarts) a timer
+ *
+ * A pending timer is cancelled first. The callback never runs early: it runs
+ * between ms and ms + 2 * AZX_TIMER_TICK_MS later. Can be called from any task,
+ * including from a timer callback, but not from interrupt context.
+ *
+ * @param[in] t The timer
+ * @param[in] ms Timeout in milliseconds
+ * @param[in] cb Callback to run on expiry
+ * @param[in] arg Argument for the callback
+ *
+ * @return FALSE if the wheel could not be started
+ */
+BOOLEAN azx_timer_start(AZX_TIMER_T *t, UINT32 ms, azx_timer_cb cb, void *arg);
+
+/**
+ * @brief Cancels a timer
+ *
+ * Once it returns, the callback will not be called for this expiry, unless it
+ * is already running on the reactor task.
+ *
+ * @param[in] t The timer
+ *
+ * @return TRUE if the timer was pending
+ */
+BOOLEAN azx_timer_cancel(AZX_TIMER_T *t);
+
+/**
+ * @brief Tells whether a timer is pending
+ *
+ * @param[in] t The timer
+ *
+ * @return TRUE between azx_timer_start() and its expiry or cancellation
+ */
+BOOLEAN azx_timer_pending(const AZX_TIMER_T *t);
+
+#endif /* HDR_AZX_TIMER_H_ */
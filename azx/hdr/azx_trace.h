@@ -0,0 +1,89 @@
+#ifndef HDR_AZX_TRACE_H_
+#define HDR_AZX_TRACE_H_
+/**
+ * @file azx_trace.h
+ * @version 1.0.0
+ * @dependencies core/azx_log
+ * @date 19/10/2026
+ *
+ * @brief Lightweight hot-path event tracer
+ *
+ * Begin/end/instant events are stored with a microsecond timestamp into a
+ * per-task ring. Each ring has a single writer (the task that owns it), so
+ * recording an event takes no lock. The rings can be dumped as text to a
+ * file or to a USB channel, and converted on the host to Chrome trace /
+ * Perfetto JSON with tools/trace2chrome.py.
+ *
+ * Tracing is compiled in only if AZX_TRACE_ENABLE is defined (see
+ * TRACE_ENABLE in Makefile.in); otherwise the macros expand to nothing.
+ *
+ * @note Do not record events from hardware timer or interrupt callbacks:
+ * they do not run in a task and would contend for a ring.
+ */
+#include "m2mb_types.h"
+
+/** @cond DEV*/
+#ifndef AZX_TRACE_MAX_TASKS
+#define AZX_TRACE_MAX_TASKS 6     /**< Number of per-task rings */
+#endif
+#ifndef AZX_TRACE_RING_SIZE
+#define AZX_TRACE_RING_SIZE 128   /**< Events per ring, must be a power of 2 */
+#endif
+/** @endcond */
+
+/**
+ * @brief Trace event types, matching the Chrome trace "ph" values
+ */
+typedef enum
+{
+  AZX_TRACE_BEGIN   = 'B',
+  AZX_TRACE_END     = 'E',
+  AZX_TRACE_INSTANT = 'i'
+} AZX_TRACE_TYPE_E;
+
+/**
+ * @brief Records an event in the ring of the calling task
+ * @private
+ *
+ * @param[in] type The event type
+ * @param[in] name The event name. Must be a string literal, only the pointer is stored.
+ * @param[in] arg A free numeric argument shown in the trace viewer
+ */
+void azx_trace_record(AZX_TRACE_TYPE_E type, const CHAR *name, UINT32 arg);
+
+/**
+ * @brief Dumps all the rings to a file, one event per line
+ *
+ * Line format: `<tid>\t<task>\t<ts_us>\t<ph>\t<name>\t<arg>`
+ *
+ * @param[in] path The file to write. It is truncated first.
+ *
+ * @return TRUE on success
+ */
+BOOLEAN azx_trace_dump_to_file(const CHAR *path);
+
+/**
+ * @brief Dumps all the rings to a USB channel, in the same format as azx_trace_dump_to_file()
+ *
+ * @param[in] path The USB channel, e.g. "/dev/USB1"
+ *
+ * @return TRUE on success
+ */
+BOOLEAN azx_trace_dump_to_usb(const CHAR *path);
+
+/**
+ * @brief Empties all the rings, keeping their task assignment
+ */
+void azx_trace_reset(void);
+
+#ifdef AZX_TRACE_ENABLE
+#define AZX_TRACE_BEGIN_EVT(name)         azx_trace_record(AZX_TRACE_BEGIN, name, 0)
+#define AZX_TRACE_END_EVT(name)           azx_trace_record(AZX_TRACE_END, name, 0)
+#define AZX_TRACE_INSTANT_EVT(name, arg)  azx_trace_record(AZX_TRACE_INSTANT, name, (UINT32)(arg))
+#else
+#define AZX_TRACE_BEGIN_EVT(name)
+#define AZX_TRACE_END_EVT(name)
+#define AZX_TRACE_INSTANT_EVT(name, arg)
+#endif
+
+#endif /* HDR_AZX_TRACE_H_ */
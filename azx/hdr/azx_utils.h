@@ -5,8 +5,8 @@
 #define HDR_M2M_UTILS_H_
 /**
  * @file azx_utils.h
- * @version 1.0.3
- * @dependencies core/azx_log
+ * @version 1.2.0
+ * @dependencies core/azx_log core/azx_timer core/azx_reactor
  * @author Ioannis Demetriou
  * @author Sorin Basca
  * @date 10/02/2019
@@ -15,6 +15,7 @@
  */
 #include "m2mb_types.h"
 #include "azx_log.h"
+#include "azx_timer.h"
 
 
 /**
@@ -40,6 +41,219 @@
  */
 void azx_sleep_ms(UINT32 ms);
 
+/**
+ * @brief Monotonic time since power-up, in microseconds
+ *
+ * The 32 bit system tick counter is extended to 64 bits and refined with
+ * m2mb_hwTmr_timeGet_ms(), which has a finer resolution than the tick on most
+ * platforms. If the system time behind m2mb_hwTmr_timeGet_ms() is changed, the
+ * clock follows the ticks and never goes backwards.
+ *
+ * The resolution is the finer of the tick and one millisecond; the unit is
+ * the microsecond so that callers do not need to change when a finer source
+ * becomes available.
+ *
+ * It must be called at least once per tick counter wrap (about 49 days with
+ * a 1 ms tick); the logger and the tracer take care of it in practice.
+ *
+ * @return Microseconds since power-up
+ */
+UINT64 azx_clock_us(void);
+
+/**
+ * @brief Monotonic time since power-up, in milliseconds
+ *
+ * @return azx_clock_us() / 1000
+ */
+UINT64 azx_clock_ms(void);
+
+/**
+ * @brief Microseconds elapsed since a timestamp taken with azx_clock_us()
+ *
+ * @param[in] since The start timestamp
+ *
+ * @return The elapsed time, saturated to 32 bits (about 71 minutes)
+ */
+UINT32 azx_elapsed_us(UINT64 since);
+
+/**
+ * @brief Milliseconds elapsed since a timestamp taken with azx_clock_us()
+ *
+ * @param[in] since The start timestamp, in microseconds
+ *
+ * @return The elapsed time in milliseconds
+ */
+UINT32 azx_elapsed_ms(UINT64 since);
+
+/**
+ * @brief Tells whether a timeout has expired
+ *
+ * @param[in] since The start timestamp, from azx_clock_us()
+ * @param[in] timeout_us The timeout in microseconds
+ *
+ * @return TRUE once timeout_us have elapsed since the start
+ */
+#define AZX_CLOCK_EXPIRED(since, timeout_us) (azx_clock_us() - (since) >= (UINT64)(timeout_us))
+
+/**
+ * @brief Waits for a time shorter than a tick
+ *
+ * The calling task blocks on a one-shot m2mb_hwTmr, so the delay has the
+ * hardware timer precision instead of the tick resolution of azx_sleep_ms().
+ * Delays below M2MB_HWTMR_MIN_TIMEOUT (100 us) are rounded up to it. If the
+ * timer cannot be created it falls back to a task sleep.
+ *
+ * @param[in] us The delay in microseconds
+ */
+void azx_delay_us(UINT32 us);
+
+/** @name Stackless coroutines
+ *
+ * Protothread-style coroutines: a multi-step sequence is written as one
+ * function, top to bottom, and gives the processor back at each wait instead
+ * of blocking a task. A coroutine costs one AZX_PT_T (a few words) instead of
+ * a task and its stack, and any number of them run interleaved on the reactor
+ * task (azx_reactor.h).
+ *
+ * The function is re-entered from the top on every wake-up and jumps back to
+ * the wait it returned from, so:
+ * - local variables do not survive a wait: keep the state in the context;
+ * - a `switch` statement cannot span a wait;
+ * - at most one AZX_PT_ macro per source line;
+ * - it must never block: use AZX_PT_SLEEP_MS() instead of azx_sleep_ms(), and
+ *   completion callbacks with AZX_PT_WAIT_UNTIL() instead of blocking calls.
+ *
+ * A coroutine is resumed by azx_pt_wake(), safe from any context, typically
+ * called by the completion callback of whatever it waits for. A wake-up only
+ * flags the coroutine and signals the reactor, so it cannot fail or be lost,
+ * and several wake-ups before the next run are coalesced into one. Spurious
+ * wake-ups are harmless: the wait condition is checked again.
+ *
+ * Nothing wakes a coroutine when a busy resource is released: when a
+ * non-blocking call reports that the resource is busy, retry it after an
+ * AZX_PT_SLEEP_MS(), as in the example below.
+ *
+ * **Example**
+ *
+ *     static AZX_PT_RESULT_E seq(AZX_PT_T *pt, void *ctx)
+ *     {
+ *       SEQ_CTX_T *c = (SEQ_CTX_T *)ctx;
+ *       AZX_PT_BEGIN(pt);
+ *       c->done = FALSE;
+ *       while((c->res = at_cmd_async_submit(0, "AT#VAUX=1,1\r", c->rsp, sizeof(c->rsp),
+ *           done_cb, pt, NULL)) == M2MB_RESULT_SM_UNAVAILABLE)
+ *       {
+ *         AZX_PT_SLEEP_MS(pt, 20);  // instance busy: poll, its release wakes nobody
+ *       }
+ *       if(c->res != M2MB_RESULT_SUCCESS)
+ *       {
+ *         AZX_PT_EXIT(pt);
+ *       }
+ *       AZX_PT_WAIT_UNTIL(pt, c->done);  // done_cb sets c->done, then azx_pt_wake(pt)
+ *       AZX_PT_SLEEP_MS(pt, 10);
+ *       AZX_PT_END(pt);
+ *     }
+ *
+ *     azx_pt_start(&pt, seq, &ctx);
+ */
+/** @{ */
+
+/** @brief Value returned by a coroutine function */
+typedef enum
+{
+  AZX_PT_WAITING,  /**< Suspended on a wait */
+  AZX_PT_ENDED     /**< Reached AZX_PT_END() or AZX_PT_EXIT() */
+} AZX_PT_RESULT_E;
+
+struct AZX_PT_S;
+
+/**
+ * @brief Coroutine function
+ *
+ * @param[in] pt The coroutine state
+ * @param[in] ctx The context given to azx_pt_start()
+ *
+ * @return Whether the coroutine is suspended or ended
+ */
+typedef AZX_PT_RESULT_E (*azx_pt_fn)(struct AZX_PT_S *pt, void *ctx);
+
+/**
+ * @brief Coroutine state, owned by the caller; the fields are private
+ */
+typedef struct AZX_PT_S
+{
+  UINT16 lc;         /* resume point: source line of the last wait */
+  UINT16 running;
+  volatile UINT32 pending;  /* woken, to be run on the next dispatch */
+  UINT32 listed;     /* linked in the coroutine list */
+  struct AZX_PT_S *next;
+  azx_pt_fn fn;
+  void *ctx;
+  AZX_TIMER_T tmr;   /* AZX_PT_SLEEP_MS() */
+} AZX_PT_T;
+
+/** @brief Opens the coroutine body */
+#define AZX_PT_BEGIN(pt) switch((pt)->lc) { case 0:
+
+/** @brief Closes the coroutine body */
+#define AZX_PT_END(pt) } (pt)->lc = 0; return AZX_PT_ENDED
+
+/** @brief Suspends the coroutine until cond is true */
+#define AZX_PT_WAIT_UNTIL(pt, cond) \
+  do { (pt)->lc = __LINE__; case __LINE__: if(!(cond)) return AZX_PT_WAITING; } while(0)
+
+/** @brief Gives the other coroutines and reactor handlers a turn */
+#define AZX_PT_YIELD(pt) \
+  do { (pt)->lc = __LINE__; azx_pt_wake(pt); return AZX_PT_WAITING; case __LINE__:; } while(0)
+
+/** @brief Suspends the coroutine for at least ms milliseconds, on the timer wheel. If the
+ *  wheel cannot be started the coroutine ends, rather than going on at once (see
+ *  azx_pt_running()) */
+#define AZX_PT_SLEEP_MS(pt, ms) \
+  do { if(!azx_timer_start(&(pt)->tmr, (ms), azx_pt_timer_cb, (pt))) \
+       { AZX_LOG_ERROR("Coroutine sleep failed, ending it\r\n"); AZX_PT_EXIT(pt); } \
+       (pt)->lc = __LINE__; case __LINE__: if(azx_timer_pending(&(pt)->tmr)) return AZX_PT_WAITING; } while(0)
+
+/** @brief Ends the coroutine from anywhere in its body */
+#define AZX_PT_EXIT(pt) do { (pt)->lc = 0; return AZX_PT_ENDED; } while(0)
+
+/**
+ * @brief Starts a coroutine on the reactor task
+ *
+ * The first run happens on the reactor task, not in the caller.
+ *
+ * @param[in] pt The coroutine state: zeroed before its first start (a static
+ *     is) and kept alive for the application lifetime, as it stays linked in
+ *     the coroutine list
+ * @param[in] fn The coroutine function
+ * @param[in] ctx Context passed to fn
+ *
+ * @return FALSE if the reactor could not be started or pt is still running
+ */
+BOOLEAN azx_pt_start(AZX_PT_T *pt, azx_pt_fn fn, void *ctx);
+
+/**
+ * @brief Resumes a suspended coroutine; safe from interrupt and timer callbacks
+ *
+ * @param[in] pt The coroutine state
+ */
+void azx_pt_wake(AZX_PT_T *pt);
+
+/**
+ * @brief Tells whether a coroutine has been started and has not ended yet
+ *
+ * @param[in] pt The coroutine state
+ *
+ * @return TRUE while the coroutine runs
+ */
+BOOLEAN azx_pt_running(const AZX_PT_T *pt);
+
+/** @cond DEV*/
+void azx_pt_timer_cb(void *arg);
+/** @endcond */
+
+/** @} */
+
 /*  @{ */
 #define AZX_UTILS_HEX_DUMP_BUFFER_SIZE 250
 /**
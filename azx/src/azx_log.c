@@ -18,11 +18,17 @@
 
 #include "app_cfg.h"
 #include "azx_log.h"
+#include "azx_utils.h"
+#include "azx_trace.h"
+#include "azx_metrics.h"
 
 /* Local defines =============================================================*/
 #define USB_CH_MAX 3
 #define LOG_BUFFER_SIZE 2048
 #define MAX_FILE_LOG_CACHE 10000
+#define FILE_LOG_FLUSH_MARK (MAX_FILE_LOG_CACHE / 2)  /* background flush from here */
+#define FLUSH_STACK_SIZE 4096
+#define FLUSH_PRIORITY 220  /* below the application tasks: the write is never urgent */
 
 #define NO_COLOUR "\033[0m"
 #define BOLD      "\033[1m"
@@ -93,6 +99,25 @@ static struct
 
 
 
+static struct
+{
+  AZX_METRIC_T *dropped;
+  AZX_METRIC_T *flush_ms;
+} log_metrics;
+
+/* Writer of the file cache: the cache has two halves, the logging path fills
+ * one while this task writes the other, so neither the reactor nor the log
+ * lock ever wait for the file system */
+static struct
+{
+  M2MB_OS_TASK_HANDLE task;
+  M2MB_OS_SEM_HANDLE go;    /* a half was handed over */
+  M2MB_OS_SEM_HANDLE idle;  /* held while a half is being written */
+  M2MB_FILE_T *fd;          /* file of the half, fixed at the handover */
+  CHAR *buf;
+  UINT32 len;
+} flusher;
+
 static CHAR log_buffer[LOG_BUFFER_SIZE] = { 0 };
 static CHAR task_name[64];
 static CHAR dateTime[32] = { 0 };
@@ -106,7 +131,8 @@ static struct
   UINT32 max_size_kb;
   AZX_LOG_LEVEL_E min_level;
   UINT32 cache_idx;
-  CHAR cache[MAX_FILE_LOG_CACHE];
+  UINT32 fill;
+  CHAR cache[2][MAX_FILE_LOG_CACHE];
 } logFile = {
   /*.fd */
       0,
@@ -122,8 +148,10 @@ static struct
   AZX_LOG_LEVEL_CRITICAL,
   /*.cache_idx */
   0,
+  /*.fill */
+  0,
   /*.cache */
-  { 0 }
+  { { 0 } }
 };
 
 
@@ -175,7 +203,11 @@ static UINT32 get_uptime(void);
 static const char* get_file_title(const CHAR* path);
 static char* get_current_task_name(CHAR *name);
 static BOOLEAN check_file_size(const CHAR* filename, UINT32 max_size_kb);
-static void flush_log_to_file(void);
+static void flush_write(M2MB_FILE_T *fd, CHAR *buf, UINT32 len);
+static BOOLEAN flush_handoff(BOOLEAN wait);
+static void flush_wait(void);
+static void flush_task(void *arg);
+static void flush_start(void);
 static void file_log_or_cache(const CHAR* buffer);
 static const CHAR* get_next_log_filename(const CHAR* filename,
     UINT32 circular_chunks, UINT32 max_size_kb);
@@ -292,12 +324,7 @@ static INT32 log_print_to_USB (const CHAR *path, const CHAR *message )
 /*-----------------------------------------------------------------------------------------------*/
 static UINT32 get_uptime(void)
 {
-
-  UINT32 sysTicks = m2mb_os_getSysTicks();
-
-  FLOAT32 ms_per_tick = m2mb_os_getSysTickDuration_ms();
-
-  return (UINT32) (sysTicks * ms_per_tick); //milliseconds
+  return (UINT32) azx_clock_ms(); //milliseconds
 }
 
 
@@ -414,6 +441,7 @@ void azx_log_init(AZX_LOG_CFG_T *cfg)
             M2MB_OS_SEM_SEL_CMD_NAME, "CSSem"));
     m2mb_os_sem_init( &log_cfg.CSSemHandle, &semAttrHandle );
   }
+  log_metrics.dropped = azx_metrics_register("log.dropped", AZX_METRIC_COUNTER);
   log_cfg.isInit = TRUE;
 }
 
@@ -549,7 +577,9 @@ INT32 azx_log_formatted(AZX_LOG_LEVEL_E level,
   /* If the selected log level is set */
   if(level >= azx_log_getLevel())
   {
+    AZX_TRACE_BEGIN_EVT("log_cs_wait");
     m2mb_os_sem_get(log_cfg.CSSemHandle, M2MB_OS_WAIT_FOREVER );
+    AZX_TRACE_END_EVT("log_cs_wait");
 
     now = get_uptime();
     /*Prepare buffer*/
@@ -572,13 +602,20 @@ INT32 azx_log_formatted(AZX_LOG_LEVEL_E level,
 
     /* Print the message on the selected output stream */
     sent = log_base_function(log_buffer);
+    if(sent < 0)
+    {
+      AZX_METRICS_INC(log_metrics.dropped);
+    }
 
     if(logFile.fd && level >= logFile.min_level)
     {
       if(!check_file_size(logFile.current_name, logFile.max_size_kb))
       {
         /* Log limit reached, so we'll need to open the next file in the rotation. Log in the file
-         * that this limit is reached and then get the next filename */
+         * that this limit is reached and then get the next filename. The cached logs go
+         * first, and the writer must be done with the file before it is closed */
+        flush_handoff(TRUE);
+        flush_wait();
         m2mb_fs_fputs("=== Log file size limit reached\r\n", logFile.fd);
         m2mb_fs_fclose(logFile.fd);
         logFile.fd = 0;
@@ -589,6 +626,7 @@ INT32 azx_log_formatted(AZX_LOG_LEVEL_E level,
 
         if(logFile.current_name[0] == '\0')
         {
+          AZX_METRICS_INC(log_metrics.dropped);
           goto end;
         }
 
@@ -596,6 +634,7 @@ INT32 azx_log_formatted(AZX_LOG_LEVEL_E level,
 
         if(!logFile.fd)
         {
+          AZX_METRICS_INC(log_metrics.dropped);
           goto end;
         }
       }
@@ -636,11 +675,97 @@ static BOOLEAN check_file_size(const CHAR* filename, UINT32 max_size_kb)
   return ((stat.st_size >> 10) < max_size_kb);
 }
 
-static void flush_log_to_file(void)
+static void flush_write(M2MB_FILE_T *fd, CHAR *buf, UINT32 len)
 {
-  logFile.cache[logFile.cache_idx] = '\0';
-  m2mb_fs_fwrite(logFile.cache, logFile.cache_idx, 1, logFile.fd);
+  UINT64 start_us = azx_clock_us();
+
+  AZX_TRACE_BEGIN_EVT("log_flush");
+  m2mb_fs_fwrite(buf, len, 1, fd);
+  AZX_TRACE_END_EVT("log_flush");
+  azx_metrics_observe(log_metrics.flush_ms, azx_elapsed_ms(start_us));
+}
+
+/* Hands the filled half over to the writer and switches to the other one; called
+ * with the log lock held. Without wait, gives up if the other half is still
+ * being written */
+static BOOLEAN flush_handoff(BOOLEAN wait)
+{
+  if(logFile.cache_idx == 0)
+  {
+    return TRUE;
+  }
+  if(!flusher.task)
+  {
+    /* No writer task: write in place */
+    flush_write(logFile.fd, logFile.cache[logFile.fill], logFile.cache_idx);
+    logFile.cache_idx = 0;
+    return TRUE;
+  }
+  if(m2mb_os_sem_get(flusher.idle, wait ? M2MB_OS_WAIT_FOREVER : M2MB_OS_NO_WAIT) != M2MB_OS_SUCCESS)
+  {
+    return FALSE;
+  }
+  flusher.fd = logFile.fd;
+  flusher.buf = logFile.cache[logFile.fill];
+  flusher.len = logFile.cache_idx;
+  logFile.fill ^= 1;
   logFile.cache_idx = 0;
+  m2mb_os_sem_put(flusher.go);
+  return TRUE;
+}
+
+/* Waits until the half handed over, if any, is written */
+static void flush_wait(void)
+{
+  if(flusher.task)
+  {
+    m2mb_os_sem_get(flusher.idle, M2MB_OS_WAIT_FOREVER);
+    m2mb_os_sem_put(flusher.idle);
+  }
+}
+
+static void flush_task(void *arg)
+{
+  (void)arg;
+  for(;;)
+  {
+    m2mb_os_sem_get(flusher.go, M2MB_OS_WAIT_FOREVER);
+    flush_write(flusher.fd, flusher.buf, flusher.len);
+    m2mb_os_sem_put(flusher.idle);
+  }
+}
+
+static void flush_start(void)
+{
+  M2MB_OS_SEM_ATTR_HANDLE semAttrHandle;
+  M2MB_OS_TASK_ATTR_HANDLE taskAttrHandle;
+
+  m2mb_os_sem_setAttrItem(&semAttrHandle,
+      CMDS_ARGS(M2MB_OS_SEM_SEL_CMD_CREATE_ATTR, NULL,
+          M2MB_OS_SEM_SEL_CMD_COUNT, 0,
+          M2MB_OS_SEM_SEL_CMD_TYPE, M2MB_OS_SEM_BINARY,
+          M2MB_OS_SEM_SEL_CMD_NAME, "LogFlGo"));
+  m2mb_os_sem_init(&flusher.go, &semAttrHandle);
+  m2mb_os_sem_setAttrItem(&semAttrHandle,
+      CMDS_ARGS(M2MB_OS_SEM_SEL_CMD_CREATE_ATTR, NULL,
+          M2MB_OS_SEM_SEL_CMD_COUNT, 1,
+          M2MB_OS_SEM_SEL_CMD_TYPE, M2MB_OS_SEM_BINARY,
+          M2MB_OS_SEM_SEL_CMD_NAME, "LogFlIdle"));
+  m2mb_os_sem_init(&flusher.idle, &semAttrHandle);
+
+  m2mb_os_taskSetAttrItem(&taskAttrHandle, CMDS_ARGS(
+      M2MB_OS_TASK_SEL_CMD_CREATE_ATTR, NULL,
+      M2MB_OS_TASK_SEL_CMD_STACK_SIZE, FLUSH_STACK_SIZE,
+      M2MB_OS_TASK_SEL_CMD_NAME, "LogFlush",
+      M2MB_OS_TASK_SEL_CMD_PRIORITY, FLUSH_PRIORITY,
+      M2MB_OS_TASK_SEL_CMD_PREEMPTIONTH, FLUSH_PRIORITY,
+      M2MB_OS_TASK_SEL_CMD_AUTOSTART, M2MB_OS_TASK_AUTOSTART));
+  if(m2mb_os_taskCreate(&flusher.task, &taskAttrHandle, flush_task, NULL) != M2MB_OS_SUCCESS)
+  {
+    /* Logs are then written by the logging task itself */
+    m2mb_os_taskSetAttrItem(&taskAttrHandle, 1, M2MB_OS_TASK_SEL_CMD_DEL_ATTR, NULL);
+    flusher.task = NULL;
+  }
 }
 
 static void file_log_or_cache(const CHAR* buffer)
@@ -649,11 +774,18 @@ static void file_log_or_cache(const CHAR* buffer)
 
   if(MAX_FILE_LOG_CACHE - 1 - size < logFile.cache_idx)
   {
-    flush_log_to_file();
+    flush_handoff(TRUE);
   }
 
-  memcpy(&logFile.cache[logFile.cache_idx], buffer, size);
+  memcpy(&logFile.cache[logFile.fill][logFile.cache_idx], buffer, size);
   logFile.cache_idx += size;
+
+  /* Hand the half over well before it is full, so the logging task rarely
+   * waits for the writer */
+  if(logFile.cache_idx >= FILE_LOG_FLUSH_MARK)
+  {
+    flush_handoff(FALSE);
+  }
 }
 
 static CHAR filenameInUse[40] = "";
@@ -747,6 +879,7 @@ BOOLEAN azx_log_send_to_file(const CHAR* filename, UINT32 circular_chunks,
 
   if(logFile.fd)
   {
+    flush_wait();
     m2mb_fs_fclose(logFile.fd);
     logFile.fd = 0;
   }
@@ -771,12 +904,18 @@ BOOLEAN azx_log_send_to_file(const CHAR* filename, UINT32 circular_chunks,
   logFile.min_level = min_level;
   logFile.max_size_kb = max_size_kb;
   logFile.cache_idx = 0;
+  log_metrics.flush_ms = azx_metrics_register("log.flush_ms", AZX_METRIC_HISTOGRAM);
+  if(!flusher.go)
+  {
+    flush_start();
+  }
   return TRUE;
 }
 
 void azx_log_flush_to_file(void)
 {
   m2mb_os_sem_get(log_cfg.CSSemHandle, M2MB_OS_WAIT_FOREVER );
-  flush_log_to_file();
+  flush_handoff(TRUE);
   m2mb_os_sem_put(log_cfg.CSSemHandle);
+  flush_wait();
 }
@@ -0,0 +1,134 @@
+/* Include files =============================================================*/
+
+#include <string.h>
+
+#include "m2mb_types.h"
+
+#include "azx_log.h"
+#include "azx_metrics.h"
+
+/* Local defines =============================================================*/
+/* Local typedefs ============================================================*/
+/* Local statics =============================================================*/
+static AZX_METRIC_T registry[AZX_METRICS_MAX];
+
+/* Number of claimed slots; a slot is visible once its name is set */
+static volatile UINT32 registry_count = 0;
+
+/* Local function prototypes =================================================*/
+static UINT32 bucket_of(UINT32 v);
+
+/* Static functions ==========================================================*/
+static UINT32 bucket_of(UINT32 v)
+{
+  UINT32 b;
+
+  if(v == 0)
+  {
+    return 0;
+  }
+  b = 32 - __builtin_clz(v);
+  return (b < AZX_METRICS_HIST_BUCKETS) ? b : AZX_METRICS_HIST_BUCKETS - 1;
+}
+
+/* Global functions ==========================================================*/
+AZX_METRIC_T* azx_metrics_register(const CHAR *name, AZX_METRIC_TYPE_E type)
+{
+  UINT32 i;
+  UINT32 count = registry_count;
+
+  for(i = 0; i < count && i < AZX_METRICS_MAX; i++)
+  {
+    if(registry[i].name && strcmp(registry[i].name, name) == 0)
+    {
+      return &registry[i];
+    }
+  }
+
+  i = __sync_fetch_and_add(&registry_count, 1);
+  if(i >= AZX_METRICS_MAX)
+  {
+    registry_count = AZX_METRICS_MAX;
+    AZX_LOG_WARN("Metrics registry full, %s dropped\r\n", name);
+    return NULL;
+  }
+  memset(&registry[i], 0, sizeof(registry[i]));
+  registry[i].type = type;
+  __sync_synchronize();
+  registry[i].name = name;
+  return &registry[i];
+}
+
+void azx_metrics_add(AZX_METRIC_T *m, UINT32 n)
+{
+  if(m)
+  {
+    __sync_fetch_and_add(&m->value, n);
+  }
+}
+
+void azx_metrics_set(AZX_METRIC_T *m, UINT32 v)
+{
+  if(m)
+  {
+    m->value = v;
+  }
+}
+
+void azx_metrics_observe(AZX_METRIC_T *m, UINT32 v)
+{
+  UINT32 old;
+
+  if(!m)
+  {
+    return;
+  }
+  __sync_fetch_and_add(&m->buckets[bucket_of(v)], 1);
+  __sync_fetch_and_add(&m->sum, v);
+  __sync_fetch_and_add(&m->value, 1);
+  do
+  {
+    old = m->max;
+  } while(v > old && !__sync_bool_compare_and_swap(&m->max, old, v));
+}
+
+UINT32 azx_metrics_snapshot(AZX_METRIC_T *out, UINT32 max_count)
+{
+  UINT32 i;
+  UINT32 n = 0;
+  UINT32 count = registry_count;
+
+  for(i = 0; i < count && i < AZX_METRICS_MAX && n < max_count; i++)
+  {
+    if(registry[i].name)
+    {
+      memcpy(&out[n++], &registry[i], sizeof(AZX_METRIC_T));
+    }
+  }
+  return n;
+}
+
+void azx_metrics_log(void)
+{
+  UINT32 i;
+  UINT32 count = registry_count;
+  const AZX_METRIC_T *m;
+
+  for(i = 0; i < count && i < AZX_METRICS_MAX; i++)
+  {
+    m = &registry[i];
+    if(!m->name)
+    {
+      continue;
+    }
+    if(m->type == AZX_METRIC_HISTOGRAM)
+    {
+      AZX_LOG_INFO("%s: n=%u avg=%u max=%u\r\n", m->name, m->value,
+          m->value ? m->sum / m->value : 0, m->max);
+    }
+    else
+    {
+      AZX_LOG_INFO("%s: %u\r\n", m->name, m->value);
+    }
+  }
+}
@@ -0,0 +1,228 @@
+/* Include files =============================================================*/
+
+#include "m2mb_types.h"
+#include "m2mb_os_api.h"
+
+#include "azx_log.h"
+#include "azx_utils.h"
+#include "azx_metrics.h"
+#include "azx_reactor.h"
+
+/* Local defines =============================================================*/
+#define REACTOR_EV_QUEUE 0x80000000U   /* posts are waiting in the queue */
+
+#ifndef AZX_REACTOR_STACK_SIZE
+#define AZX_REACTOR_STACK_SIZE 4096
+#endif
+
+#ifndef AZX_REACTOR_PRIORITY
+#define AZX_REACTOR_PRIORITY 197  /* above the drivers: handlers must be short */
+#endif
+
+#if AZX_REACTOR_MAX_SOURCES > 31
+#error AZX_REACTOR_MAX_SOURCES must be at most 31
+#endif
+
+/* Local typedefs ============================================================*/
+typedef enum
+{
+  REACTOR_UNINIT,
+  REACTOR_STARTING,
+  REACTOR_RUNNING,
+  REACTOR_FAILED
+} REACTOR_STATE_E;
+
+typedef struct
+{
+  const CHAR *name;
+  azx_reactor_handler handler;  /* set last: the source is live once it is */
+  void *ctx;
+} REACTOR_SOURCE_T;
+
+typedef struct
+{
+  UINT32 src;
+  UINT32 arg;
+} REACTOR_MSG_T;
+
+/* Local statics =============================================================*/
+static REACTOR_SOURCE_T sources[AZX_REACTOR_MAX_SOURCES];
+static volatile UINT32 source_count = 0;
+
+static volatile UINT32 reactor_state = REACTOR_UNINIT;
+static M2MB_OS_EV_HANDLE reactor_ev = NULL;
+static M2MB_OS_Q_HANDLE reactor_q = NULL;
+static UINT32 reactor_q_area[AZX_REACTOR_QUEUE_LEN * WORD32_FOR_MSG(REACTOR_MSG_T)];
+static M2MB_OS_TASK_HANDLE reactor_task = NULL;
+
+static struct
+{
+  AZX_METRIC_T *dispatched;
+  AZX_METRIC_T *dropped;
+  AZX_METRIC_T *handler_us;
+} reactor_metrics;
+
+/* Local function prototypes =================================================*/
+static void dispatch(UINT32 src, UINT32 arg);
+static void reactor_fn(void *arg);
+static BOOLEAN reactor_setup(void);
+
+/* Static functions ==========================================================*/
+static void dispatch(UINT32 src, UINT32 arg)
+{
+  REACTOR_SOURCE_T *s;
+  UINT64 start;
+
+  if(src >= AZX_REACTOR_MAX_SOURCES || !sources[src].handler)
+  {
+    return;
+  }
+  s = &sources[src];
+  start = azx_clock_us();
+  s->handler(arg, s->ctx);
+  azx_metrics_observe(reactor_metrics.handler_us, azx_elapsed_us(start));
+  AZX_METRICS_INC(reactor_metrics.dispatched);
+}
+
+static void reactor_fn(void *arg)
+{
+  REACTOR_MSG_T msg;
+  UINT32 flags;
+  (void)arg;
+
+  for(;;)
+  {
+    flags = 0;
+    m2mb_os_ev_get(reactor_ev, 0xFFFFFFFFU, M2MB_OS_EV_GET_ANY_AND_CLEAR, &flags,
+        M2MB_OS_WAIT_FOREVER);
+
+    while(flags & ~REACTOR_EV_QUEUE)
+    {
+      UINT32 src = __builtin_ctz(flags);
+      flags &= ~(1U << src);
+      dispatch(src, 0);
+    }
+    if(flags & REACTOR_EV_QUEUE)
+    {
+      while(m2mb_os_q_rx(reactor_q, &msg, M2MB_OS_NO_WAIT) == M2MB_OS_SUCCESS)
+      {
+        dispatch(msg.src, msg.arg);
+      }
+    }
+  }
+}
+
+static BOOLEAN reactor_setup(void)
+{
+  M2MB_OS_EV_ATTR_HANDLE evAttrHandle;
+  M2MB_OS_Q_ATTR_HANDLE qAttrHandle;
+  M2MB_OS_TASK_ATTR_HANDLE taskAttrHandle;
+
+  reactor_metrics.dispatched = azx_metrics_register("reactor.dispatched", AZX_METRIC_COUNTER);
+  reactor_metrics.dropped = azx_metrics_register("reactor.dropped", AZX_METRIC_COUNTER);
+  reactor_metrics.handler_us = azx_metrics_register("reactor.handler_us", AZX_METRIC_HISTOGRAM);
+
+  if(m2mb_os_ev_setAttrItem(&evAttrHandle, CMDS_ARGS(
+      M2MB_OS_EV_SEL_CMD_CREATE_ATTR, NULL,
+      M2MB_OS_EV_SEL_CMD_NAME, "AzxRctEv")) != M2MB_OS_SUCCESS ||
+      m2mb_os_ev_init(&reactor_ev, &evAttrHandle) != M2MB_OS_SUCCESS)
+  {
+    AZX_LOG_ERROR("Cannot create reactor event group\r\n");
+    return FALSE;
+  }
+  if(m2mb_os_q_setAttrItem(&qAttrHandle, CMDS_ARGS(
+      M2MB_OS_Q_SEL_CMD_CREATE_ATTR, NULL,
+      M2MB_OS_Q_SEL_CMD_NAME, "AzxRctQ",
+      M2MB_OS_Q_SEL_CMD_QSTART, reactor_q_area,
+      M2MB_OS_Q_SEL_CMD_MSG_SIZE, WORD32_FOR_MSG(REACTOR_MSG_T),
+      M2MB_OS_Q_SEL_CMD_QSIZE, sizeof(reactor_q_area))) != M2MB_OS_SUCCESS)
+  {
+    AZX_LOG_ERROR("Cannot create reactor queue attributes\r\n");
+    return FALSE;
+  }
+  if(m2mb_os_q_init(&reactor_q, &qAttrHandle) != M2MB_OS_SUCCESS)
+  {
+    m2mb_os_q_setAttrItem(&qAttrHandle, 1, M2MB_OS_Q_SEL_CMD_DEL_ATTR, NULL);
+    AZX_LOG_ERROR("Cannot create reactor queue\r\n");
+    return FALSE;
+  }
+
+  m2mb_os_taskSetAttrItem(&taskAttrHandle, CMDS_ARGS(
+      M2MB_OS_TASK_SEL_CMD_CREATE_ATTR, NULL,
+      M2MB_OS_TASK_SEL_CMD_STACK_SIZE, AZX_REACTOR_STACK_SIZE,
+      M2MB_OS_TASK_SEL_CMD_NAME, "AzxReactor",
+      M2MB_OS_TASK_SEL_CMD_PRIORITY, AZX_REACTOR_PRIORITY,
+      M2MB_OS_TASK_SEL_CMD_PREEMPTIONTH, AZX_REACTOR_PRIORITY,
+      M2MB_OS_TASK_SEL_CMD_AUTOSTART, M2MB_OS_TASK_AUTOSTART));
+  if(m2mb_os_taskCreate(&reactor_task, &taskAttrHandle, reactor_fn, NULL) != M2MB_OS_SUCCESS)
+  {
+    m2mb_os_taskSetAttrItem(&taskAttrHandle, 1, M2MB_OS_TASK_SEL_CMD_DEL_ATTR, NULL);
+    AZX_LOG_ERROR("Cannot create reactor task\r\n");
+    return FALSE;
+  }
+  return TRUE;
+}
+
+/* Global functions ==========================================================*/
+BOOLEAN azx_reactor_init(void)
+{
+  if(__sync_bool_compare_and_swap(&reactor_state, REACTOR_UNINIT, REACTOR_STARTING))
+  {
+    reactor_state = reactor_setup() ? REACTOR_RUNNING : REACTOR_FAILED;
+  }
+  while(reactor_state == REACTOR_STARTING)
+  {
+    azx_sleep_ms(1);
+  }
+  return reactor_state == REACTOR_RUNNING;
+}
+
+INT32 azx_reactor_add(const CHAR *name, azx_reactor_handler handler, void *ctx)
+{
+  UINT32 i;
+
+  if(!handler || !azx_reactor_init())
+  {
+    return -1;
+  }
+  i = __sync_fetch_and_add(&source_count, 1);
+  if(i >= AZX_REACTOR_MAX_SOURCES)
+  {
+    source_count = AZX_REACTOR_MAX_SOURCES;
+    AZX_LOG_ERROR("Reactor full, %s dropped\r\n", name);
+    return -1;
+  }
+  sources[i].name = name;
+  sources[i].ctx = ctx;
+  __sync_synchronize();
+  sources[i].handler = handler;
+  AZX_LOG_DEBUG("Reactor source %u: %s\r\n", i, name);
+  return (INT32)i;
+}
+
+void azx_reactor_signal(INT32 src)
+{
+  if(src >= 0 && src < AZX_REACTOR_MAX_SOURCES)
+  {
+    m2mb_os_ev_set(reactor_ev, 1U << src, M2MB_OS_EV_SET);
+  }
+}
+
+BOOLEAN azx_reactor_post(INT32 src, UINT32 arg)
+{
+  REACTOR_MSG_T msg;
+
+  if(src < 0 || src >= AZX_REACTOR_MAX_SOURCES)
+  {
+    return FALSE;
+  }
+  msg.src = (UINT32)src;
+  msg.arg = arg;
+  if(m2mb_os_q_tx(reactor_q, &msg, M2MB_OS_NO_WAIT, 0) != M2MB_OS_SUCCESS)
+  {
+    AZX_METRICS_INC(reactor_metrics.dropped);
+    return FALSE;
+  }
+  m2mb_os_ev_set(reactor_ev, REACTOR_EV_QUEUE, M2MB_OS_EV_SET);
+  return TRUE;
+}
@@ -0,0 +1,273 @@
+/* Include files =============================================================*/
+
+#include "m2mb_types.h"
+#include "m2mb_os_api.h"
+
+#include "azx_log.h"
+#include "azx_utils.h"
+#include "azx_metrics.h"
+#include "azx_reactor.h"
+#include "azx_timer.h"
+
+/* Local defines =============================================================*/
+#define TIMER_SLOT_MASK (AZX_TIMER_WHEEL_SLOTS - 1)
+
+#if (AZX_TIMER_WHEEL_SLOTS & TIMER_SLOT_MASK) != 0
+#error AZX_TIMER_WHEEL_SLOTS must be a power of 2
+#endif
+
+/* Local typedefs ============================================================*/
+typedef enum
+{
+  TIMER_UNINIT,
+  TIMER_STARTING,
+  TIMER_RUNNING,
+  TIMER_FAILED
+} TIMER_STATE_E;
+
+/* Local statics =============================================================*/
+/* Slot and due lists are circular, with a sentinel node as head: a pending
+ * timer can be unlinked without knowing which list holds it */
+static AZX_TIMER_T wheel[AZX_TIMER_WHEEL_SLOTS];
+static AZX_TIMER_T due;
+
+static UINT32 wheel_tick;      /* last tick processed */
+static UINT32 pending_count;   /* timers in the wheel or in the due list */
+static BOOLEAN tmr_running;
+
+static volatile UINT32 timer_state = TIMER_UNINIT;
+static M2MB_OS_SEM_HANDLE lock = NULL;
+static M2MB_OS_TMR_HANDLE tick_tmr = NULL;
+static INT32 tick_src = -1;
+
+static AZX_METRIC_T *fired;
+static AZX_METRIC_T *pending_gauge;
+
+/* Local function prototypes =================================================*/
+static UINT32 now_tick(void);
+static void list_init(AZX_TIMER_T *head);
+static void list_append(AZX_TIMER_T *head, AZX_TIMER_T *t);
+static void list_unlink(AZX_TIMER_T *t);
+static void tick_cb(M2MB_OS_TMR_HANDLE handle, void *arg);
+static void advance(void);
+static void tick_handler(UINT32 arg, void *ctx);
+static BOOLEAN timer_setup(void);
+
+/* Static functions ==========================================================*/
+static UINT32 now_tick(void)
+{
+  return (UINT32)(azx_clock_ms() / AZX_TIMER_TICK_MS);
+}
+
+static void list_init(AZX_TIMER_T *head)
+{
+  head->next = head;
+  head->prev = head;
+}
+
+static void list_append(AZX_TIMER_T *head, AZX_TIMER_T *t)
+{
+  t->prev = head->prev;
+  t->next = head;
+  head->prev->next = t;
+  head->prev = t;
+}
+
+static void list_unlink(AZX_TIMER_T *t)
+{
+  t->prev->next = t->next;
+  t->next->prev = t->prev;
+  t->next = NULL;
+  t->prev = NULL;
+}
+
+static void tick_cb(M2MB_OS_TMR_HANDLE handle, void *arg)
+{
+  (void)handle;
+  (void)arg;
+  azx_reactor_signal(tick_src);
+}
+
+/* Visits every slot up to the current tick, so ticks lost while the reactor
+ * was preempted are caught up. Expired timers move to the due list. Called
+ * with the lock held. */
+static void advance(void)
+{
+  UINT32 now = now_tick();
+
+  while((INT32)(now - wheel_tick) > 0)
+  {
+    AZX_TIMER_T *head, *t, *next;
+
+    wheel_tick++;
+    head = &wheel[wheel_tick & TIMER_SLOT_MASK];
+    for(t = head->next; t != head; t = next)
+    {
+      next = t->next;
+      if(t->rounds == 0)
+      {
+        list_unlink(t);
+        list_append(&due, t);
+      }
+      else
+      {
+        t->rounds--;
+      }
+    }
+  }
+}
+
+static void tick_handler(UINT32 arg, void *ctx)
+{
+  (void)arg;
+  (void)ctx;
+
+  m2mb_os_sem_get(lock, M2MB_OS_WAIT_FOREVER);
+  advance();
+
+  /* One callback at a time, without the lock: it may start or cancel timers */
+  while(due.next != &due)
+  {
+    AZX_TIMER_T *t = due.next;
+    azx_timer_cb cb = t->cb;
+    void *cb_arg = t->arg;
+
+    list_unlink(t);
+    pending_count--;
+    m2mb_os_sem_put(lock);
+    AZX_METRICS_INC(fired);
+    cb(cb_arg);
+    m2mb_os_sem_get(lock, M2MB_OS_WAIT_FOREVER);
+  }
+
+  if(pending_count == 0 && tmr_running)
+  {
+    m2mb_os_tmr_stop(tick_tmr);
+    tmr_running = FALSE;
+  }
+  azx_metrics_set(pending_gauge, pending_count);
+  m2mb_os_sem_put(lock);
+}
+
+static BOOLEAN timer_setup(void)
+{
+  M2MB_OS_SEM_ATTR_HANDLE semAttrHandle;
+  M2MB_OS_TMR_ATTR_HANDLE tmrAttrHandle;
+  UINT32 ticks = M2MB_OS_MS2TICKS(AZX_TIMER_TICK_MS);
+  UINT32 i;
+
+  for(i = 0; i < AZX_TIMER_WHEEL_SLOTS; i++)
+  {
+    list_init(&wheel[i]);
+  }
+  list_init(&due);
+  fired = azx_metrics_register("timer.fired", AZX_METRIC_COUNTER);
+  pending_gauge = azx_metrics_register("timer.pending", AZX_METRIC_GAUGE);
+
+  m2mb_os_sem_setAttrItem(&semAttrHandle, CMDS_ARGS(M2MB_OS_SEM_SEL_CMD_CREATE_ATTR, NULL,
+      M2MB_OS_SEM_SEL_CMD_COUNT, 1, M2MB_OS_SEM_SEL_CMD_TYPE, M2MB_OS_SEM_BINARY,
+      M2MB_OS_SEM_SEL_CMD_NAME, "AzxTmrLk"));
+  if(m2mb_os_sem_init(&lock, &semAttrHandle) != M2MB_OS_SUCCESS)
+  {
+    AZX_LOG_ERROR("Cannot create timer lock\r\n");
+    return FALSE;
+  }
+  tick_src = azx_reactor_add("timer", tick_handler, NULL);
+  if(tick_src < 0)
+  {
+    return FALSE;
+  }
+  if(m2mb_os_tmr_setAttrItem(&tmrAttrHandle, CMDS_ARGS(
+      M2MB_OS_TMR_SEL_CMD_CREATE_ATTR, NULL,
+      M2MB_OS_TMR_SEL_CMD_NAME, "AzxWheel",
+      M2MB_OS_TMR_SEL_CMD_CB_FUNC, &tick_cb,
+      M2MB_OS_TMR_SEL_CMD_ARG_CB, NULL,
+      M2MB_OS_TMR_SEL_CMD_TICKS_PERIOD, ticks ? ticks : 1,
+      M2MB_OS_TMR_SEL_CMD_PERIODIC, M2MB_OS_TMR_PERIODIC_TMR)) != M2MB_OS_SUCCESS)
+  {
+    AZX_LOG_ERROR("Cannot create wheel timer attributes\r\n");
+    return FALSE;
+  }
+  if(m2mb_os_tmr_init(&tick_tmr, &tmrAttrHandle) != M2MB_OS_SUCCESS)
+  {
+    m2mb_os_tmr_setAttrItem(&tmrAttrHandle, 1, M2MB_OS_TMR_SEL_CMD_DEL_ATTR, NULL);
+    AZX_LOG_ERROR("Cannot create wheel timer\r\n");
+    return FALSE;
+  }
+  return TRUE;
+}
+
+/* Global functions ==========================================================*/
+BOOLEAN azx_timer_init(void)
+{
+  if(__sync_bool_compare_and_swap(&timer_state, TIMER_UNINIT, TIMER_STARTING))
+  {
+    timer_state = timer_setup() ? TIMER_RUNNING : TIMER_FAILED;
+  }
+  while(timer_state == TIMER_STARTING)
+  {
+    azx_sleep_ms(1);
+  }
+  return timer_state == TIMER_RUNNING;
+}
+
+BOOLEAN azx_timer_start(AZX_TIMER_T *t, UINT32 ms, azx_timer_cb cb, void *arg)
+{
+  UINT32 expiry;
+
+  if(!t || !cb || !azx_timer_init())
+  {
+    return FALSE;
+  }
+
+  m2mb_os_sem_get(lock, M2MB_OS_WAIT_FOREVER);
+  if(t->next)
+  {
+    list_unlink(t);
+    pending_count--;
+  }
+  if(pending_count == 0)
+  {
+    /* Empty wheel: nothing to catch up, jump to the current tick */
+    wheel_tick = now_tick();
+  }
+
+  /* One extra tick covers the part of the current one already elapsed */
+  expiry = now_tick() + (ms + AZX_TIMER_TICK_MS - 1) / AZX_TIMER_TICK_MS + 1;
+  t->cb = cb;
+  t->arg = arg;
+  t->rounds = (expiry - wheel_tick - 1) / AZX_TIMER_WHEEL_SLOTS;
+  list_append(&wheel[expiry & TIMER_SLOT_MASK], t);
+  pending_count++;
+
+  if(!tmr_running)
+  {
+    tmr_running = (m2mb_os_tmr_start(tick_tmr) == M2MB_OS_SUCCESS);
+  }
+  m2mb_os_sem_put(lock);
+  return TRUE;
+}
+
+BOOLEAN azx_timer_cancel(AZX_TIMER_T *t)
+{
+  BOOLEAN was_pending = FALSE;
+
+  if(!t || timer_state != TIMER_RUNNING)
+  {
+    return FALSE;
+  }
+  m2mb_os_sem_get(lock, M2MB_OS_WAIT_FOREVER);
+  if(t->next)
+  {
+    list_unlink(t);
+    pending_count--;
+    was_pending = TRUE;
+  }
+  m2mb_os_sem_put(lock);
+  return was_pending;
+}
+
+BOOLEAN azx_timer_pending(const AZX_TIMER_T *t)
+{
+  return t && t->next != NULL;
+}
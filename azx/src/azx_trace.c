@@ -0,0 +1,187 @@
+/* Include files =============================================================*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "m2mb_types.h"
+#include "m2mb_os_api.h"
+#include "m2mb_usb.h"
+#include "m2mb_fs_stdio.h"
+
+#include "azx_log.h"
+#include "azx_utils.h"
+#include "azx_trace.h"
+
+/* Local defines =============================================================*/
+#define TRACE_RING_MASK (AZX_TRACE_RING_SIZE - 1)
+#define TRACE_LINE_SIZE 96
+#define MIN(i,j) (((i) < (j)) ? (i) : (j))
+
+/* Local typedefs ============================================================*/
+typedef struct
+{
+  UINT64 ts_us;
+  const CHAR *name;
+  UINT32 arg;
+  UINT32 type;
+} TRACE_EVENT_T;
+
+typedef struct
+{
+  M2MB_OS_TASK_HANDLE owner;
+  CHAR task_name[16];
+  volatile UINT32 head;    /* total events written, only advanced by the owner */
+  TRACE_EVENT_T events[AZX_TRACE_RING_SIZE];
+} TRACE_RING_T;
+
+typedef BOOLEAN (*trace_write_fn)(const CHAR *line, UINT32 len, void *ctx);
+
+/* Local statics =============================================================*/
+static TRACE_RING_T rings[AZX_TRACE_MAX_TASKS];
+
+/* Local function prototypes =================================================*/
+static TRACE_RING_T* get_ring(void);
+static BOOLEAN dump(trace_write_fn write_fn, void *ctx);
+static BOOLEAN write_to_file(const CHAR *line, UINT32 len, void *ctx);
+static BOOLEAN write_to_usb(const CHAR *line, UINT32 len, void *ctx);
+
+/* Static functions ==========================================================*/
+/*----------------------------------------------------------------------------*/
+/*!
+  \brief Returns the ring owned by the calling task, claiming a free one on first use
+
+  \return the ring, NULL if all the rings are taken by other tasks
+ */
+/*----------------------------------------------------------------------------*/
+static TRACE_RING_T* get_ring(void)
+{
+  M2MB_OS_TASK_HANDLE self = m2mb_os_taskGetId();
+  MEM_W name = 0;
+  UINT32 i;
+
+  for(i = 0; i < AZX_TRACE_MAX_TASKS; i++)
+  {
+    if(rings[i].owner == self)
+    {
+      return &rings[i];
+    }
+  }
+
+  for(i = 0; i < AZX_TRACE_MAX_TASKS; i++)
+  {
+    if(rings[i].owner == NULL &&
+        __sync_bool_compare_and_swap(&rings[i].owner, NULL, self))
+    {
+      if(M2MB_OS_SUCCESS == m2mb_os_taskGetItem(self, M2MB_OS_TASK_SEL_CMD_NAME, &name, NULL))
+      {
+        snprintf(rings[i].task_name, sizeof(rings[i].task_name), "%s", (const CHAR*)name);
+      }
+      return &rings[i];
+    }
+  }
+  return NULL;
+}
+
+static BOOLEAN dump(trace_write_fn write_fn, void *ctx)
+{
+  CHAR line[TRACE_LINE_SIZE];
+  UINT32 i;
+  UINT32 idx;
+  UINT32 head;
+  UINT32 first;
+  INT32 len;
+
+  for(i = 0; i < AZX_TRACE_MAX_TASKS; i++)
+  {
+    if(rings[i].owner == NULL)
+    {
+      continue;
+    }
+    /* The owner may keep writing while we read: only the oldest events can be overwritten */
+    head = rings[i].head;
+    first = (head > AZX_TRACE_RING_SIZE) ? head - AZX_TRACE_RING_SIZE : 0;
+    for(idx = first; idx < head; idx++)
+    {
+      const TRACE_EVENT_T *ev = &rings[i].events[idx & TRACE_RING_MASK];
+      len = snprintf(line, sizeof(line), "%u\t%s\t%llu\t%c\t%s\t%u\n", i, rings[i].task_name,
+          (unsigned long long)ev->ts_us, (CHAR)ev->type, ev->name ? ev->name : "?", ev->arg);
+      if(len > 0 && !write_fn(line, MIN((UINT32)len, sizeof(line) - 1), ctx))
+      {
+        return FALSE;
+      }
+    }
+  }
+  return TRUE;
+}
+
+static BOOLEAN write_to_file(const CHAR *line, UINT32 len, void *ctx)
+{
+  return m2mb_fs_fwrite((void*)line, len, 1, (M2MB_FILE_T*)ctx) == 1;
+}
+
+static BOOLEAN write_to_usb(const CHAR *line, UINT32 len, void *ctx)
+{
+  return m2mb_usb_write(*(INT32*)ctx, line, len) == (SSIZE_T)len;
+}
+
+/* Global functions ==========================================================*/
+void azx_trace_record(AZX_TRACE_TYPE_E type, const CHAR *name, UINT32 arg)
+{
+  TRACE_RING_T *ring = get_ring();
+  TRACE_EVENT_T *ev;
+
+  if(!ring)
+  {
+    return;
+  }
+  ev = &ring->events[ring->head & TRACE_RING_MASK];
+  ev->ts_us = azx_clock_us();
+  ev->name = name;
+  ev->arg = arg;
+  ev->type = (UINT32)type;
+  /* Publish the event only once it is complete */
+  __sync_synchronize();
+  ring->head++;
+}
+
+BOOLEAN azx_trace_dump_to_file(const CHAR *path)
+{
+  M2MB_FILE_T *fd;
+  BOOLEAN res;
+
+  fd = m2mb_fs_fopen(path, "w");
+  if(!fd)
+  {
+    AZX_LOG_ERROR("Cannot open trace file %s\r\n", path);
+    return FALSE;
+  }
+  res = dump(write_to_file, fd);
+  m2mb_fs_fclose(fd);
+  return res;
+}
+
+BOOLEAN azx_trace_dump_to_usb(const CHAR *path)
+{
+  INT32 fd;
+  BOOLEAN res;
+
+  fd = m2mb_usb_open(path, 0);
+  if(fd == -1)
+  {
+    AZX_LOG_ERROR("Cannot open trace channel %s\r\n", path);
+    return FALSE;
+  }
+  res = dump(write_to_usb, &fd);
+  m2mb_usb_close(fd);
+  return res;
+}
+
+void azx_trace_reset(void)
+{
+  UINT32 i;
+
+  for(i = 0; i < AZX_TRACE_MAX_TASKS; i++)
+  {
+    rings[i].head = 0;
+  }
+}
@@ -7,16 +7,231 @@
 #include "m2mb_os_types.h"
 #include "m2mb_os_api.h"
 #include "m2mb_power.h"
+#include "m2mb_hwTmr.h"
 
 #include "azx_log.h"
 
 #include "azx_utils.h"
+#include "azx_reactor.h"
 
 void azx_sleep_ms(UINT32 ms)
 {
   m2mb_os_taskSleep( M2MB_OS_MS2TICKS(ms) );
 }
 
+/* Clock state: ticks extended to 64 bits, last returned value, and the
+ * m2mb_hwTmr_timeGet_ms() value matching tick 0 */
+static volatile UINT64 clock_ticks = 0;
+static volatile UINT64 clock_last_us = 0;
+static volatile UINT64 clock_hw_base_ms = 0;
+static UINT32 clock_ns_per_tick = 0;
+
+/* 64 bit loads are not atomic on 32 bit cores: go through a no-op CAS */
+static UINT64 load64(volatile UINT64 *p)
+{
+  return __sync_val_compare_and_swap(p, 0, 0);
+}
+
+static UINT64 clock_ext_ticks(void)
+{
+  UINT64 prev, ext;
+
+  do
+  {
+    prev = load64(&clock_ticks);
+    ext = (prev & ~(UINT64)0xFFFFFFFF) | (UINT32)m2mb_os_getSysTicks();
+    if(ext < prev)
+    {
+      ext += (UINT64)1 << 32;
+    }
+  } while(ext != prev && !__sync_bool_compare_and_swap(&clock_ticks, prev, ext));
+  return ext;
+}
+
+UINT64 azx_clock_us(void)
+{
+  UINT64 hw_ms = 0, tick_us, hw_us, t, last, base;
+  UINT64 tick_len_us;
+
+  if(clock_ns_per_tick == 0)
+  {
+    clock_ns_per_tick = (UINT32)(m2mb_os_getSysTickDuration_ms() * 1000000.0f);
+  }
+  tick_us = clock_ext_ticks() * clock_ns_per_tick / 1000;
+  tick_len_us = clock_ns_per_tick / 1000 + 1;
+  m2mb_hwTmr_timeGet_ms(&hw_ms);
+
+  base = load64(&clock_hw_base_ms);
+  if(base == 0)
+  {
+    __sync_bool_compare_and_swap(&clock_hw_base_ms, 0, hw_ms - tick_us / 1000);
+    base = load64(&clock_hw_base_ms);
+  }
+  hw_us = (hw_ms - base) * 1000;
+  if(hw_us + 1000 + tick_len_us < tick_us || hw_us > tick_us + 1000 + tick_len_us)
+  {
+    /* The system time was changed: follow the ticks again */
+    __sync_bool_compare_and_swap(&clock_hw_base_ms, base, hw_ms - tick_us / 1000);
+    t = tick_us;
+  }
+  else
+  {
+    /* Both sources agree: the larger one is the most recent */
+    t = (hw_us > tick_us) ? hw_us : tick_us;
+  }
+
+  /* Never go backwards, even across tasks */
+  do
+  {
+    last = load64(&clock_last_us);
+    if(t <= last)
+    {
+      return last;
+    }
+  } while(!__sync_bool_compare_and_swap(&clock_last_us, last, t));
+  return t;
+}
+
+UINT64 azx_clock_ms(void)
+{
+  return azx_clock_us() / 1000;
+}
+
+UINT32 azx_elapsed_us(UINT64 since)
+{
+  UINT64 d = azx_clock_us() - since;
+  return (d > 0xFFFFFFFF) ? 0xFFFFFFFF : (UINT32)d;
+}
+
+UINT32 azx_elapsed_ms(UINT64 since)
+{
+  return (UINT32)((azx_clock_us() - since) / 1000);
+}
+
+static void delay_cb(M2MB_HWTMR_HANDLE handle, void *arg)
+{
+  (void)handle;
+  m2mb_os_sem_put((M2MB_OS_SEM_HANDLE)arg);
+}
+
+void azx_delay_us(UINT32 us)
+{
+  M2MB_OS_SEM_ATTR_HANDLE semAttrHandle;
+  M2MB_OS_SEM_HANDLE sem = NULL;
+  M2MB_HWTMR_ATTR_HANDLE tmrAttrHandle;
+  M2MB_HWTMR_HANDLE tmr = NULL;
+
+  if(us < M2MB_HWTMR_MIN_TIMEOUT)
+  {
+    us = M2MB_HWTMR_MIN_TIMEOUT;
+  }
+  m2mb_os_sem_setAttrItem(&semAttrHandle, CMDS_ARGS(M2MB_OS_SEM_SEL_CMD_CREATE_ATTR, NULL,
+      M2MB_OS_SEM_SEL_CMD_COUNT, 0, M2MB_OS_SEM_SEL_CMD_TYPE, M2MB_OS_SEM_BINARY,
+      M2MB_OS_SEM_SEL_CMD_NAME, "DelaySem"));
+  if(m2mb_os_sem_init(&sem, &semAttrHandle) != M2MB_OS_SUCCESS)
+  {
+    azx_sleep_ms(us / 1000 + 1);
+    return;
+  }
+
+  if(m2mb_hwTmr_setAttrItem(&tmrAttrHandle, 1, M2MB_HWTMR_SEL_CMD_CREATE_ATTR, NULL) == M2MB_HWTMR_SUCCESS &&
+      m2mb_hwTmr_setAttrItem(&tmrAttrHandle, CMDS_ARGS(
+          M2MB_HWTMR_SEL_CMD_CB_FUNC, &delay_cb,
+          M2MB_HWTMR_SEL_CMD_ARG_CB, sem,
+          M2MB_HWTMR_SEL_CMD_TIME_DURATION, us,
+          M2MB_HWTMR_SEL_CMD_PERIODIC, M2MB_HWTMR_ONESHOT_TMR,
+          M2MB_HWTMR_SEL_CMD_AUTOSTART, M2MB_HWTMR_AUTOSTART)) == M2MB_HWTMR_SUCCESS &&
+      m2mb_hwTmr_init(&tmr, &tmrAttrHandle) == M2MB_HWTMR_SUCCESS)
+  {
+    m2mb_os_sem_get(sem, M2MB_OS_MS2TICKS(us / 1000 + 10));
+    m2mb_hwTmr_deinit(tmr);
+  }
+  else
+  {
+    azx_sleep_ms(us / 1000 + 1);
+  }
+  m2mb_os_sem_deinit(sem);
+}
+
+/* One reactor source runs all the coroutines: a wake-up flags the coroutine
+ * and signals the source, and the handler runs every flagged coroutine.
+ * Coroutines are linked in pt_list on their first start and never unlinked,
+ * their state being owned by the caller for the whole application life. */
+static INT32 pt_src = -1;
+static AZX_PT_T *volatile pt_list = NULL;
+
+static void pt_handler(UINT32 arg, void *ctx)
+{
+  AZX_PT_T *pt;
+  (void)arg;
+  (void)ctx;
+
+  for(pt = pt_list; pt; pt = pt->next)
+  {
+    if(__sync_bool_compare_and_swap(&pt->pending, 1, 0) && pt->running &&
+        pt->fn(pt, pt->ctx) == AZX_PT_ENDED)
+    {
+      azx_timer_cancel(&pt->tmr);
+      pt->running = FALSE;
+    }
+  }
+}
+
+BOOLEAN azx_pt_start(AZX_PT_T *pt, azx_pt_fn fn, void *ctx)
+{
+  AZX_PT_T *head;
+
+  if(!pt || !fn || pt->running)
+  {
+    return FALSE;
+  }
+  if(pt_src < 0)
+  {
+    INT32 src = azx_reactor_add("coroutines", pt_handler, NULL);
+    if(src < 0)
+    {
+      return FALSE;
+    }
+    pt_src = src;
+  }
+  pt->lc = 0;
+  pt->pending = 0;
+  pt->fn = fn;
+  pt->ctx = ctx;
+  if(!pt->listed)
+  {
+    memset(&pt->tmr, 0, sizeof(pt->tmr));
+    pt->listed = TRUE;
+    do
+    {
+      head = pt_list;
+      pt->next = head;
+    } while(!__sync_bool_compare_and_swap(&pt_list, head, pt));
+  }
+  pt->running = TRUE;
+  azx_pt_wake(pt);
+  return TRUE;
+}
+
+void azx_pt_wake(AZX_PT_T *pt)
+{
+  if(pt && pt->running)
+  {
+    pt->pending = 1;
+    azx_reactor_signal(pt_src);
+  }
+}
+
+BOOLEAN azx_pt_running(const AZX_PT_T *pt)
+{
+  return pt && pt->running;
+}
+
+void azx_pt_timer_cb(void *arg)
+{
+  azx_pt_wake((AZX_PT_T *)arg);
+}
+
 
 #define MIN(i,j) (((i) < (j)) ? (i) : (j))
 const CHAR* azx_hex_dump(const void* data, UINT32 len)
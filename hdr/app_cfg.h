@@ -22,4 +22,15 @@
 /*Local basepath for samples that need local files usage*/
 #define LOCALPATH "/data/azc/mod"
 
+/*Folder holding the audio files played with AT#APLAY, used only to skip empty clips early: a
+  clip not found there is still handed to AT#APLAY*/
+#define AUDIO_FILES_DIR "/data/aplay"
+
+/*Push-to-play input: GPIO number and the clip it triggers. The GPIO is set by TRIGGER_GPIO in
+  Makefile.in, 0 (or undefined) disables the input*/
+#ifndef TRIGGER_GPIO
+#define TRIGGER_GPIO 0
+#endif
+#define TRIGGER_FILE "one_tone.wav"
+
 #endif /* HDR_APP_CFG_H_ */
@@ -0,0 +1,91 @@
+/**
+ * @file at_batch.h
+ * @version 1.0.0
+ * @date 19/10/2026
+ *
+ * @brief Batching of AT commands on a single command line
+ *
+ * Each command sent on its own pays a full ATI turnaround. Runs of chainable
+ * commands are merged into one line (AT$GPSP=1;$GPSSAV;#VAUX=1,1) that fits
+ * in AT_BATCH_LINE_MAX, and the combined response is split back into one
+ * response per command.
+ *
+ * Commands that open a prompt, enter data mode, reset the parser or keep it
+ * busy (#APLAY, ATD, +CMGS, #SSEND...) are never merged and go on a line of
+ * their own.
+ *
+ * The modem stops a command line at the first failing command and answers a
+ * single ERROR, without saying which one failed: at_batch_send() then sends
+ * the commands of that line again one by one. Only batch commands that can
+ * safely run twice, like settings and queries.
+ */
+
+#ifndef HDR_AT_BATCH_H_
+#define HDR_AT_BATCH_H_
+#include "m2mb_types.h"
+
+/** Longest command line, terminator included */
+#define AT_BATCH_LINE_MAX 80
+
+/** Size of the combined response of a line */
+#define AT_BATCH_RSP_LEN 256
+
+/**
+ * @brief A command of a batch
+ */
+typedef struct
+{
+  const CHAR *cmd;   /**< Full command, "AT...\r" */
+  CHAR *rsp;         /**< Its response, optional */
+  UINT32 rsp_len;    /**< Size of rsp */
+  BOOLEAN ok;        /**< Set when the modem answered OK */
+} AT_BATCH_CMD_T;
+
+/**
+ * @brief Tells whether a command can share a command line with others
+ *
+ * @param[in] cmd The full command, "AT...\r"
+ *
+ * @return TRUE if it can be merged
+ */
+BOOLEAN at_batch_chainable(const CHAR *cmd);
+
+/**
+ * @brief Merges the longest run of commands that fits in one line
+ *
+ * @param[in] cmds The commands, merged from the first one
+ * @param[in] count Number of commands
+ * @param[out] line The command line, to be sent as is
+ * @param[in] line_len Size of line
+ *
+ * @return Number of commands in line: 1 for a standalone command, 0 if the
+ *     first command does not fit in line at all
+ */
+UINT32 at_batch_compile(const AT_BATCH_CMD_T *cmds, UINT32 count, CHAR *line, UINT32 line_len);
+
+/**
+ * @brief Splits the response to a line built by at_batch_compile()
+ *
+ * Each information line goes to the command whose name it starts with, or to
+ * the last command matched when it has no name. Every command gets its own
+ * final result, so its response can be checked as if it was sent alone.
+ *
+ * @param[in] rsp The response to the whole line
+ * @param[in,out] cmds The commands of the line
+ * @param[in] count Number of commands in the line
+ */
+void at_batch_split(const CHAR *rsp, AT_BATCH_CMD_T *cmds, UINT32 count);
+
+/**
+ * @brief Sends commands with as few round trips as possible, blocking
+ *
+ * @param[in] instance The ATI instance
+ * @param[in,out] cmds The commands, sent in order; responses and outcomes are
+ *     filled in
+ * @param[in] count Number of commands
+ *
+ * @return M2MB_RESULT_SUCCESS if every command was accepted
+ */
+M2MB_RESULT_E at_batch_send(INT16 instance, AT_BATCH_CMD_T *cmds, UINT32 count);
+
+#endif /* HDR_AT_BATCH_H_ */
@@ -0,0 +1,76 @@
+/**
+ * @file at_cache.h
+ * @version 1.0.0
+ * @date 19/10/2026
+ *
+ * @brief Response cache for AT queries returning static or slowly changing data
+ *
+ * Queries such as AT+CGSN, AT+CGMR or AT#CCID are answered from memory while
+ * their cached response is fresh, without any modem traffic and without
+ * taking the AT critical section. Each cacheable command has a time to live
+ * and the events that invalidate it, both set in the policy table of
+ * at_cache.c; any other command goes straight to send_async_at_command().
+ *
+ * Only successful responses are cached. Hits and misses are counted in the
+ * at.cache_hits and at.cache_misses metrics.
+ *
+ * The cache is opt-in: only queries sent with at_cache_send() use it, plain
+ * send_async_at_command() calls always reach the modem. at_cmd_async_init()
+ * sets it up; before that at_cache_send() sends every command. The application
+ * has no such query on its boot path, so nothing uses it there. Live readings
+ * like AT+CSQ are never cached.
+ */
+
+#ifndef HDR_AT_CACHE_H_
+#define HDR_AT_CACHE_H_
+#include "m2mb_types.h"
+
+/** Time to live of responses that never change */
+#define AT_CACHE_FOREVER 0xFFFFFFFF
+
+/** @name Invalidation events
+ * @{ */
+#define AT_CACHE_EV_SIM     0x00000001  /**< SIM inserted, removed or swapped */
+#define AT_CACHE_EV_NETWORK 0x00000002  /**< Registration or operator change */
+#define AT_CACHE_EV_ALL     0xFFFFFFFF  /**< Modem reset: everything */
+/** @} */
+
+/**
+ * @brief Creates the cache lock, called by at_cmd_async_init()
+ */
+void at_cache_init(void);
+
+/**
+ * @brief Sends a command, or answers it from the cache
+ *
+ * Same contract as send_async_at_command().
+ *
+ * @param[in] instance The ATI instance
+ * @param[in] atCmd The full command, "AT...\r"
+ * @param[out] atRsp The response
+ * @param[in] atRspMaxLen Size of atRsp
+ *
+ * @return M2MB_RESULT_SUCCESS if a response was received or found in the cache
+ */
+M2MB_RESULT_E at_cache_send(INT16 instance, const CHAR *atCmd, CHAR *atRsp, UINT32 atRspMaxLen);
+
+/**
+ * @brief Drops the cached responses invalidated by events
+ *
+ * Does not block: can be called from the ATI callback context.
+ *
+ * @param[in] events AT_CACHE_EV_* bits
+ */
+void at_cache_invalidate(UINT32 events);
+
+/**
+ * @brief Invalidation hook for unsolicited results
+ *
+ * Maps the URCs signalling a SIM or network change (#QSS, +CREG...) to
+ * at_cache_invalidate(). Called by the AT layer for every URC.
+ *
+ * @param[in] urc The unsolicited result
+ */
+void at_cache_urc(const CHAR *urc);
+
+#endif /* HDR_AT_CACHE_H_ */
@@ -0,0 +1,130 @@
+/**
+ * @file at_parse.h
+ * @version 1.0.0
+ * @date 19/10/2026
+ *
+ * @brief Typed decoders for AT response lines
+ *
+ * Each decoder finds its line in a response ("+CSQ: 21,99") and fills a C
+ * struct, driven by a table of fields. There is no heap, no sscanf and no
+ * copy: strings are returned as pointer and length into the response, which
+ * must stay valid while they are used. The work is a single pass over the
+ * response, bounded by its length.
+ *
+ * Missing trailing fields are left to their defaults, so optional parameters
+ * need no special case. at_parse_line() decodes any other line from a table
+ * of the caller.
+ */
+
+#ifndef HDR_AT_PARSE_H_
+#define HDR_AT_PARSE_H_
+#include "m2mb_types.h"
+
+/** Value of the integer fields that are missing */
+#define AT_PARSE_NONE (-1)
+
+/**
+ * @brief Field types
+ */
+typedef enum
+{
+  AT_PARSE_INT,   /**< Decimal integer, INT32 */
+  AT_PARSE_STR,   /**< String, quoted or not, AT_PARSE_STR_T */
+  AT_PARSE_SKIP   /**< Field not stored */
+} AT_PARSE_TYPE_E;
+
+/**
+ * @brief A field of a line: its type and where it goes in the output struct
+ */
+typedef struct
+{
+  AT_PARSE_TYPE_E type;
+  UINT16 offset;   /**< offsetof() of the member */
+} AT_PARSE_FIELD_T;
+
+/**
+ * @brief A string inside the response, not terminated
+ */
+typedef struct
+{
+  const CHAR *p;
+  UINT16 len;
+} AT_PARSE_STR_T;
+
+/** +CSQ: <rssi>,<ber> */
+typedef struct
+{
+  INT32 rssi;   /**< 0..31, 99 if unknown */
+  INT32 ber;    /**< 0..7, 99 if unknown */
+} AT_CSQ_T;
+
+/** #GPIO: <dir>,<stat> */
+typedef struct
+{
+  INT32 dir;    /**< 0 input, 1 output */
+  INT32 stat;   /**< Pin level */
+} AT_GPIO_T;
+
+/** #APLAY: <status>[,<file>] */
+typedef struct
+{
+  INT32 status;        /**< 0 idle, 1 playing */
+  AT_PARSE_STR_T file; /**< The clip, when reported */
+} AT_APLAY_T;
+
+/** +CREG: [<n>,]<stat>[,<lac>,<ci>[,<act>]], read response or URC */
+typedef struct
+{
+  INT32 n;             /**< URC mode, AT_PARSE_NONE in a URC */
+  INT32 stat;          /**< Registration status */
+  AT_PARSE_STR_T lac;  /**< Location area code, hexadecimal */
+  AT_PARSE_STR_T ci;   /**< Cell id, hexadecimal */
+  INT32 act;           /**< Access technology */
+} AT_CREG_T;
+
+/**
+ * @brief Decodes the line of a response starting with prefix
+ *
+ * The fields not found in the line keep the value they had in out.
+ *
+ * @param[in] rsp The response, terminated
+ * @param[in] prefix The line prefix, e.g. "+CSQ: "
+ * @param[in] fields The fields, in order
+ * @param[in] count Number of fields
+ * @param[out] out The struct the field offsets refer to
+ *
+ * @return Number of fields decoded, -1 if no line starts with prefix or a
+ *     field is malformed
+ */
+INT32 at_parse_line(const CHAR *rsp, const CHAR *prefix, const AT_PARSE_FIELD_T *fields,
+    UINT32 count, void *out);
+
+/**
+ * @brief Decodes a +CSQ response
+ *
+ * @return TRUE if both fields were decoded
+ */
+BOOLEAN at_parse_csq(const CHAR *rsp, AT_CSQ_T *out);
+
+/**
+ * @brief Decodes a #GPIO read response
+ *
+ * @return TRUE if both fields were decoded
+ */
+BOOLEAN at_parse_gpio(const CHAR *rsp, AT_GPIO_T *out);
+
+/**
+ * @brief Decodes a #APLAY? response
+ *
+ * @return TRUE if at least the status was decoded
+ */
+BOOLEAN at_parse_aplay(const CHAR *rsp, AT_APLAY_T *out);
+
+/**
+ * @brief Decodes a +CREG? response or a +CREG URC
+ *
+ * @return TRUE if at least the status was decoded
+ */
+BOOLEAN at_parse_creg(const CHAR *rsp, AT_CREG_T *out);
+
+#endif /* HDR_AT_PARSE_H_ */
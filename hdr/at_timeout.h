@@ -0,0 +1,70 @@
+/**
+ * @file at_timeout.h
+ * @version 1.0.0
+ * @date 19/10/2026
+ *
+ * @brief Response timeouts of the AT commands, learnt from their latency
+ *
+ * Commands are grouped in classes with similar latency (quick local settings,
+ * audio, network procedures, everything else). Each class starts from a
+ * default timeout and then follows its observed latency like a TCP
+ * retransmission timeout: smoothed mean plus four times the mean deviation,
+ * within the bounds of the class. A timeout doubles the timeout of its class,
+ * up to the upper bound.
+ *
+ * The current timeouts are exported as the at.rto_<class>_ms gauges.
+ */
+
+#ifndef HDR_AT_TIMEOUT_H_
+#define HDR_AT_TIMEOUT_H_
+#include "m2mb_types.h"
+
+/**
+ * @brief Latency classes
+ */
+typedef enum
+{
+  AT_TMO_QUICK,    /**< Local settings and queries: ATE, #VAUX, #DVI, #GPIO... */
+  AT_TMO_AUDIO,    /**< Audio playback control: #APLAY */
+  AT_TMO_NETWORK,  /**< Network procedures: +COPS, +CGACT, #SGACT... */
+  AT_TMO_DEFAULT,  /**< Anything else */
+  AT_TMO_MAX
+} AT_TMO_CLASS_E;
+
+/**
+ * @brief Gets the class of a command
+ *
+ * A command line holding several commands (AT$GPSP=1;$GPSSAV) gets the class
+ * of its slowest command, the one with the longest upper bound.
+ *
+ * @param[in] cmd The command, "AT...\r"
+ *
+ * @return The class
+ */
+AT_TMO_CLASS_E at_timeout_class(const CHAR *cmd);
+
+/**
+ * @brief Gets the current response timeout of a class
+ *
+ * @param[in] cls The class
+ *
+ * @return The timeout in ms
+ */
+UINT32 at_timeout_get(AT_TMO_CLASS_E cls);
+
+/**
+ * @brief Feeds the latency of a command answered in time
+ *
+ * @param[in] cls The class of the command
+ * @param[in] latency_ms Time from the send to the end of the response
+ */
+void at_timeout_sample(AT_TMO_CLASS_E cls, UINT32 latency_ms);
+
+/**
+ * @brief Reports a command that timed out: backs off the timeout of its class
+ *
+ * @param[in] cls The class of the command
+ */
+void at_timeout_expired(AT_TMO_CLASS_E cls);
+
+#endif /* HDR_AT_TIMEOUT_H_ */
@@ -12,10 +12,50 @@
 #define HDR_AT_UTILS_H_
 #include "m2mb_types.h"
 
+/*Priority classes of the AT commands: a busy instance is handed over to the waiting command of
+  the lowest class first. Waiting ages background commands up to the interactive class, so they
+  are not starved, but nothing overtakes an urgent command*/
+typedef enum
+{
+  AT_PRIO_URGENT,       /*control that must not wait, e.g. stopping the playback*/
+  AT_PRIO_INTERACTIVE,  /*default*/
+  AT_PRIO_BACKGROUND,   /*polling and queries*/
+  AT_PRIO_MAX
+} AT_PRIO_E;
+
+/*Instance reserved to urgent commands: when initialized with at_cmd_async_init(), every urgent
+  command is sent on it, whatever the instance asked for*/
+#define AT_URGENT_INSTANCE 1
+
+/*Unsolicited result handler: called from the ATI callback context, must not block*/
+typedef void (*at_urc_cb)(const CHAR *urc);
+
 /*Async mode (with callback)*/
 M2MB_RESULT_E at_cmd_async_init(INT16 instance);
 M2MB_RESULT_E at_cmd_async_deinit(INT16 instance);
 M2MB_RESULT_E send_async_at_command(INT16 instance, const CHAR *atCmd, CHAR *atRsp, UINT32 atRspMaxLen);
+M2MB_RESULT_E send_async_at_command_prio(INT16 instance, AT_PRIO_E prio, const CHAR *atCmd,
+    CHAR *atRsp, UINT32 atRspMaxLen);
+void at_cmd_async_set_urc_cb(at_urc_cb cb);
+
+/*Completion of at_cmd_async_submit(): called from the ATI callback context or the reactor task,
+  must not block. The response is in the buffer given to at_cmd_async_submit() on success*/
+typedef void (*at_done_cb)(M2MB_RESULT_E result, void *arg);
+
+/*Non-blocking send: returns M2MB_RESULT_SM_UNAVAILABLE at once if another command is in progress,
+  or if the instance is still waiting for the end of an abandoned command (retry later: after
+  2 s without it, the next call restarts the ATI session and goes through). On
+  M2MB_RESULT_SUCCESS the outcome is reported to cb, and atRsp must stay valid until then. id,
+  optional, receives the command ID for at_cmd_async_cancel()*/
+M2MB_RESULT_E at_cmd_async_submit(INT16 instance, const CHAR *atCmd, CHAR *atRsp, UINT32 atRspMaxLen,
+    at_done_cb cb, void *arg, UINT32 *id);
+
+/*Cancels a submitted command: cb is called at once with M2MB_RESULT_FAIL and the instance is
+  recovered before its next command (late response dropped, parser back to IDLE within a bounded
+  time). Returns M2MB_RESULT_FAIL if the command has already completed. Only submitted commands
+  have an ID: a blocking send (send_async_at_command*()) cannot be cancelled, it is bounded by
+  the timeout of its class (at_timeout.h)*/
+M2MB_RESULT_E at_cmd_async_cancel(UINT32 id);
 
 /*Sync mode (without callback)*/
 M2MB_RESULT_E at_cmd_sync_init(INT16 instance);
@@ -0,0 +1,155 @@
+/**
+ * @file audio_svc.h
+ * @version 1.0.0
+ * @date 19/10/2026
+ *
+ * @brief Persistent audio service task
+ *
+ * The service task powers up and configures the codec once, then keeps the
+ * ATI instance, the codec I2C session and the DVI configuration warm while
+ * it serves play/stop/volume/config requests posted by other tasks.
+ *
+ * Clips are chained through a playlist: the end of a clip is detected from
+ * the @ref AUDIO_SVC_URC_END unsolicited result or, if that is missed, by
+ * polling AT#APLAY? while playing, and the next clip is started at once.
+ *
+ * While the codec is ready, its key registers are read back every
+ * @ref AUDIO_SVC_VERIFY_MS and any register lost to a brownout or reset is
+ * restored (see codec_verify()).
+ *
+ * When nothing has played for @ref AUDIO_SVC_IDLE_MS the codec is shut down
+ * (see codec_sleep()); the next request that needs it wakes it first.
+ *
+ * All the request functions only enqueue a message and return immediately.
+ */
+
+#ifndef HDR_AUDIO_SVC_H_
+#define HDR_AUDIO_SVC_H_
+#include "m2mb_types.h"
+
+/** Maximum length of an audio file name, terminator included */
+#define AUDIO_SVC_FILE_LEN 32
+
+/** Depth of the request queue */
+#define AUDIO_SVC_QUEUE_LEN 8
+
+/** Period of the codec configuration check, in milliseconds, 0 to disable */
+#ifndef AUDIO_SVC_VERIFY_MS
+#define AUDIO_SVC_VERIFY_MS 5000
+#endif
+
+/** Idle time before the codec is shut down, in milliseconds, 0 to keep it powered */
+#ifndef AUDIO_SVC_IDLE_MS
+#define AUDIO_SVC_IDLE_MS 3000
+#endif
+
+/** Duration of the volume change ramp, in milliseconds */
+#define AUDIO_SVC_VOLUME_RAMP_MS 40
+
+/** Unsolicited result sent by the modem at the end of a playback */
+#define AUDIO_SVC_URC_END "#APLAYEV: 0"
+
+/**
+ * @brief Requests served by the audio service
+ */
+typedef enum
+{
+  AUDIO_SVC_PLAY,    /**< Append a file to the playlist, play it at once if idle */
+  AUDIO_SVC_PLAY_NOW,/**< Stop the current clip and play a file immediately */
+  AUDIO_SVC_STOP,    /**< Stop the current playback and clear the playlist */
+  AUDIO_SVC_VOLUME,  /**< Set the DAC attenuation register */
+  AUDIO_SVC_CONFIG,  /**< Re-apply DVI and codec configuration */
+  AUDIO_SVC_PROFILE, /**< Switch the codec sample-rate profile */
+  AUDIO_SVC_TRIGGER  /**< Priority playback from an input event */
+} AUDIO_SVC_CMD_E;
+
+/**
+ * @brief Starts the audio service task
+ *
+ * The ATI instance must be already initialized with at_cmd_async_init(); the
+ * service never deinitializes it.
+ *
+ * @param[in] instance The ATI instance used by the service
+ *
+ * @return TRUE if the task and its queue were created
+ */
+BOOLEAN audio_svc_start(INT16 instance);
+
+/**
+ * @brief Appends a file to the playlist
+ *
+ * Playback starts immediately if nothing is playing, otherwise the file is
+ * validated in the background and chained after the queued ones.
+ *
+ * @param[in] file The audio file name, as known to AT#APLAY
+ *
+ * @return M2MB_RESULT_SUCCESS if the request was queued
+ */
+M2MB_RESULT_E audio_svc_play(const CHAR *file);
+
+/**
+ * @brief Priority playback: stops the current clip and plays a file at once
+ *
+ * The rest of the playlist resumes after it.
+ *
+ * @param[in] file The audio file name, as known to AT#APLAY
+ *
+ * @return M2MB_RESULT_SUCCESS if the request was queued
+ */
+M2MB_RESULT_E audio_svc_play_now(const CHAR *file);
+
+/**
+ * @brief Stops the current playback and requests to clear the playlist
+ *
+ * AT#APLAY=0 is sent at once from the calling task, as an urgent command on
+ * the reserved instance when there is one, so the caller blocks until the
+ * modem answers: do not call it from the reactor or an ATI callback. Only the
+ * playlist update is queued, ahead of the pending requests; until it is served
+ * the service starts no clip, so the stop cannot be overtaken by the playlist.
+ *
+ * @return M2MB_RESULT_SUCCESS if the playlist update was queued
+ */
+M2MB_RESULT_E audio_svc_stop(void);
+
+/**
+ * @brief Requests a volume change
+ *
+ * The attenuation is ramped over @ref AUDIO_SVC_VOLUME_RAMP_MS to avoid clicks.
+ *
+ * @param[in] atten DAC attenuation in 0.5 dB steps from +3 dB (see CODEC_REG_DAC_ATTEN)
+ *
+ * @return M2MB_RESULT_SUCCESS if the request was queued
+ */
+M2MB_RESULT_E audio_svc_volume(UINT8 atten);
+
+/**
+ * @brief Requests to re-apply the DVI and codec register configuration
+ *
+ * @return M2MB_RESULT_SUCCESS if the request was queued
+ */
+M2MB_RESULT_E audio_svc_config(void);
+
+/**
+ * @brief Requests a codec sample-rate profile change
+ *
+ * @param[in] profile One of CODEC_PROFILE_E
+ *
+ * @return M2MB_RESULT_SUCCESS if the request was queued
+ */
+M2MB_RESULT_E audio_svc_profile(UINT32 profile);
+
+/**
+ * @brief Priority playback requested by an input event
+ *
+ * Same as audio_svc_play_now(); in addition the delay from the event to the
+ * AT#APLAY command is recorded in the audio.trigger_ms histogram. Safe to call
+ * from interrupt and timer callbacks.
+ *
+ * @param[in] file The audio file name, as known to AT#APLAY
+ * @param[in] edge_ms Time of the event, low 32 bits of azx_clock_ms()
+ *
+ * @return M2MB_RESULT_SUCCESS if the request was queued
+ */
+M2MB_RESULT_E audio_svc_trigger(const CHAR *file, UINT32 edge_ms);
+
+#endif /* HDR_AUDIO_SVC_H_ */
@@ -0,0 +1,92 @@
+/**
+ * @file boot_prof.h
+ * @version 1.0.0
+ * @date 19/10/2026
+ *
+ * @brief Boot-to-first-audio profiler
+ *
+ * Records a begin/end timestamp pair for every phase of the boot flow in
+ * M2MB_main(), persists them in a compact binary file under LOCALPATH and
+ * prints a summary (with the delta against the previous boot) on the log.
+ */
+
+#ifndef HDR_BOOT_PROF_H_
+#define HDR_BOOT_PROF_H_
+#include "m2mb_types.h"
+#include "app_cfg.h"
+
+/** File where the last boot profile is stored */
+#define BOOT_PROF_FILE LOCALPATH "/boot_prof.bin"
+
+/**
+ * @brief Profiled boot phases, in boot order
+ */
+typedef enum
+{
+  BOOT_PROF_INITIAL_SLEEP, /**< Settle delay at the start of the boot sequence */
+  BOOT_PROF_ATI_INIT,      /**< at_cmd_async_init() */
+  BOOT_PROF_GPS_CFG,       /**< One-time configuration: snapshot read, or query + AT$GPSP / AT$GPSSAV */
+  BOOT_PROF_VAUX,          /**< AT#VAUX supply enable */
+  BOOT_PROF_GPIO,          /**< AT#GPIO codec enable pin */
+  BOOT_PROF_DVI,           /**< on_codec(), AT#DVI */
+  BOOT_PROF_CODEC_I2C,     /**< send_to_codec() register blob */
+  BOOT_PROF_ATE0_LOOP,     /**< ATE0, skipped if echo is already off */
+  BOOT_PROF_APLAY,         /**< AT#APLAY issue */
+
+  BOOT_PROF_PHASE_MAX
+} BOOT_PROF_PHASE_E;
+
+/**
+ * @brief Per-phase record, as stored in @ref BOOT_PROF_FILE
+ *
+ * Both values are in milliseconds; start is relative to power-up.
+ * A phase that never ran has start and duration equal to 0xFFFFFFFF.
+ */
+typedef struct
+{
+  UINT32 start_ms;
+  UINT32 duration_ms;
+} BOOT_PROF_PHASE_T;
+
+/**
+ * @brief Starts a new profile
+ *
+ * Takes the reference time and converts it to time since power-up using the
+ * system tick counter. Call it as the very first thing in M2MB_main().
+ */
+void boot_prof_init(void);
+
+/**
+ * @brief Marks the beginning of a phase
+ *
+ * @param[in] phase The phase that starts now
+ */
+void boot_prof_begin(BOOT_PROF_PHASE_E phase);
+
+/**
+ * @brief Marks the end of a phase
+ *
+ * @param[in] phase The phase that ends now
+ */
+void boot_prof_end(BOOT_PROF_PHASE_E phase);
+
+/**
+ * @brief Closes the profile, stores it and logs the summary
+ *
+ * The previous profile is read back from @ref BOOT_PROF_FILE before being
+ * overwritten, so the summary also reports the per-phase delta against it.
+ *
+ * @return TRUE if the profile could be written to the file
+ */
+BOOLEAN boot_prof_finish(void);
+
+/**
+ * @brief Returns the stored record of a phase
+ *
+ * @param[in] phase The phase to query
+ *
+ * @return Pointer to the record, or NULL if phase is out of range
+ */
+const BOOT_PROF_PHASE_T* boot_prof_get(BOOT_PROF_PHASE_E phase);
+
+#endif /* HDR_BOOT_PROF_H_ */
@@ -0,0 +1,201 @@
+/**
+ * @file codec.h
+ * @version 1.0.0
+ * @date 19/10/2026
+ *
+ * @brief MAX9860 audio codec driver
+ *
+ * Register access to the codec over I2C, through the bus scheduler
+ * (i2c_bus.h). The bus session is opened on first use and kept open until
+ * codec_close(), so repeated writes do not pay the open/ioctl cost again.
+ */
+
+#ifndef HDR_CODEC_H_
+#define HDR_CODEC_H_
+#include "m2mb_types.h"
+
+#define CODEC_I2C_ADDR 0x10
+
+/** Transactions per latency benchmark run at bring-up, 0 to disable (see codec_bench()) */
+#ifndef CODEC_I2C_BENCH
+#define CODEC_I2C_BENCH 0
+#endif
+
+/** @name Registers checked by codec_verify() by default: one 14 byte burst read */
+/** @{ */
+#define CODEC_VERIFY_FIRST 0x03
+#define CODEC_VERIFY_COUNT 14
+/** @} */
+
+
+/** Register blob written at power-up: start address 0x02, then registers 0x02..0x10 */
+#define CODEC_DEFAULT_CFG "0220101000242000003300540000008b"
+
+/** @name MAX9860 registers */
+/** @{ */
+#define CODEC_REG_STATUS    0x00 /**< Interrupt status */
+#define CODEC_REG_SYSCLK    0x03 /**< System clock, followed by the N divider (0x04, 0x05) */
+#define CODEC_REG_DAC_ATTEN 0x09 /**< DAC attenuation, 0.5 dB steps from +3 dB (0x00) */
+#define CODEC_REG_ADC_LEVEL 0x0A /**< ADC level, left and right nibbles, 1 dB steps from +3 dB */
+#define CODEC_REG_PWRMAN       0x10 /**< Power management */
+/** @} */
+
+#define CODEC_STATUS_ULK    0x20 /**< PLL unlocked */
+#define CODEC_SYSCLK_16KHZ  0x01 /**< 16 kHz filters */
+#define CODEC_PWRMAN_SHDN      0x80 /**< Set to power on, clear to shut down */
+#define CODEC_DAC_MUTE      0xFE /**< Lowest DAC attenuation step */
+
+/** Longest wait for PLL lock after a profile change, in milliseconds */
+#define CODEC_PLL_LOCK_TIMEOUT_MS 20
+
+/** Registers held per rate profile, from CODEC_REG_SYSCLK */
+#define CODEC_PROFILE_REGS 3
+
+/**
+ * @brief Sample-rate profiles
+ */
+typedef enum
+{
+  CODEC_PROFILE_NB,     /**< Narrowband voice, 8 kHz */
+  CODEC_PROFILE_WB,     /**< Wideband voice, 16 kHz */
+  CODEC_PROFILE_PROMPT, /**< Prompt playback, 32 kHz */
+  CODEC_PROFILE_MAX
+} CODEC_PROFILE_E;
+
+/**
+ * @brief Registers the codec on the I2C bus scheduler, starting it if needed
+ *
+ * @return TRUE if the codec can be accessed
+ */
+BOOLEAN codec_open(void);
+
+/**
+ * @brief Closes the I2C session to the codec; it is reopened on next access
+ */
+void codec_close(void);
+
+/**
+ * @brief Writes a raw I2C message given as a hex string
+ *
+ * The first byte is the start register address, the following bytes are
+ * written to consecutive registers.
+ *
+ * @param[in] str Zero terminated string with an even number of [0-9a-fA-F] characters
+ *
+ * @return TRUE on success
+ */
+BOOLEAN codec_write_hex(const CHAR *str);
+
+/**
+ * @brief Writes a single register
+ *
+ * @param[in] reg The register address
+ * @param[in] val The value to write
+ *
+ * @return TRUE on success
+ */
+BOOLEAN codec_write_reg(UINT8 reg, UINT8 val);
+
+/**
+ * @brief Reads consecutive registers in a single combined write-read transaction
+ *
+ * @param[in] reg The first register address
+ * @param[out] val Buffer receiving the values, at least count bytes
+ * @param[in] count The number of registers to read
+ *
+ * @return TRUE on success
+ */
+BOOLEAN codec_read_regs(UINT8 reg, UINT8 *val, UINT8 count);
+
+/**
+ * @brief Reads a single register
+ *
+ * @param[in] reg The register address
+ * @param[out] val The register value
+ *
+ * @return TRUE on success
+ */
+BOOLEAN codec_read_reg(UINT8 reg, UINT8 *val);
+
+/**
+ * @brief Gets the value last written to a register, without bus access
+ *
+ * @param[in] reg The register address
+ * @param[out] val The cached value
+ *
+ * @return FALSE if the register was never written
+ */
+BOOLEAN codec_get_cached(UINT8 reg, UINT8 *val);
+
+/**
+ * @brief Checks that the codec still holds the intended configuration
+ *
+ * Reads count registers from first in one burst and compares them with the
+ * values last written through this driver. Registers never written are not
+ * checked. Runs of differing registers are rewritten with one burst each.
+ *
+ * @param[in] first The first register to check
+ * @param[in] count The number of registers to check
+ *
+ * @return The number of registers restored, -1 on bus failure
+ */
+INT32 codec_verify(UINT8 first, UINT8 count);
+
+/**
+ * @brief Switches the codec to a sample-rate profile
+ *
+ * The codec must have been configured first (e.g. with CODEC_DEFAULT_CFG).
+ * Only the clock registers that differ from the current configuration are
+ * written. The DAC is muted and the codec held in shutdown during the change,
+ * then the status register is polled until the PLL locks (at most
+ * CODEC_PLL_LOCK_TIMEOUT_MS) before unmuting. The switch time goes to the
+ * codec.reclock_us histogram.
+ *
+ * @param[in] profile The profile to apply
+ *
+ * @return TRUE on success
+ */
+BOOLEAN codec_set_profile(CODEC_PROFILE_E profile);
+
+/**
+ * @brief Puts the codec in shutdown, its lowest power state
+ *
+ * Clears SHDN in the power management register. The cached configuration is
+ * left untouched for codec_wake(). codec_verify() does nothing while the codec
+ * is asleep.
+ *
+ * @return TRUE if the codec is in shutdown
+ */
+BOOLEAN codec_sleep(void);
+
+/**
+ * @brief Brings the codec out of shutdown
+ *
+ * Rewrites the cached registers 0x02..0x10, SHDN included, in one burst.
+ * Time spent in shutdown is added to the codec.shutdown_ms counter, the wake
+ * latency goes to the codec.wake_us histogram.
+ *
+ * @return TRUE if the codec is powered
+ */
+BOOLEAN codec_wake(void);
+
+/**
+ * @brief Tells whether the codec is in shutdown
+ *
+ * @return TRUE after codec_sleep(), until codec_wake()
+ */
+BOOLEAN codec_is_asleep(void);
+
+/**
+ * @brief Measures the transaction latency of the active bus backend
+ *
+ * Rewrites the current DAC attenuation and reads it back count times each,
+ * then logs the average cost of a write and of a write-read transaction and
+ * feeds them to the codec.bench_xfer_us histogram. Build once per backend to
+ * compare them.
+ *
+ * @param[in] count Transactions per measurement
+ */
+void codec_bench(UINT32 count);
+
+#endif /* HDR_CODEC_H_ */
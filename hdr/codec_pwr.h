@@ -0,0 +1,52 @@
+/**
+ * @file codec_pwr.h
+ * @version 1.0.0
+ * @date 19/10/2026
+ *
+ * @brief Codec power sequencing
+ *
+ * The VAUX supply has no m2mb API and is still switched with AT#VAUX. The
+ * codec enable line (GPIO7) is driven directly through m2mb_gpio instead of
+ * AT#GPIO, with the settle delays timed by azx_delay_us().
+ */
+
+#ifndef HDR_CODEC_PWR_H_
+#define HDR_CODEC_PWR_H_
+#include "m2mb_types.h"
+
+#define CODEC_PWR_GPIO "/dev/GPIO7"
+
+/** Settle time after VAUX is switched on, in microseconds */
+#define CODEC_PWR_VAUX_SETTLE_US 2000
+
+/** Settle time after the enable line goes high, in microseconds */
+#define CODEC_PWR_ENABLE_SETTLE_US 500
+
+/**
+ * @brief Switches the VAUX supply on with AT#VAUX and waits for it to settle
+ *
+ * Nothing is sent and there is no wait if the modem state model knows that
+ * VAUX is already on (see modem_state.h).
+ *
+ * @param[in] instance The ATI instance to use
+ *
+ * @return TRUE on success
+ */
+BOOLEAN codec_pwr_vaux_on(INT16 instance);
+
+/**
+ * @brief Drives the codec enable line high and waits for the codec to settle
+ *
+ * Logs the time taken and the time saved against an AT#GPIO round trip,
+ * estimated from the at.latency_ms metric.
+ *
+ * @return TRUE on success
+ */
+BOOLEAN codec_pwr_enable(void);
+
+/**
+ * @brief Drives the codec enable line low
+ */
+void codec_pwr_disable(void);
+
+#endif /* HDR_CODEC_PWR_H_ */
@@ -0,0 +1,72 @@
+/**
+ * @file codec_ramp.h
+ * @version 1.0.0
+ * @date 19/10/2026
+ *
+ * @brief Click-free codec gain ramps
+ *
+ * A gain change is split into steps timed by a periodic m2mb_hwTmr. The timer
+ * callback only computes the next value and queues it to a worker task, which
+ * writes the 2 byte register update through the persistent codec session.
+ * The number of bus transactions per ramp is bounded by
+ * @ref CODEC_RAMP_MAX_STEPS, and repeated values are not sent again.
+ */
+
+#ifndef HDR_CODEC_RAMP_H_
+#define HDR_CODEC_RAMP_H_
+#include "m2mb_types.h"
+
+/** Maximum bus transactions per ramp */
+#define CODEC_RAMP_MAX_STEPS 32
+
+/** Shortest interval between two steps, in microseconds */
+#define CODEC_RAMP_MIN_STEP_US 1000
+
+/**
+ * @brief Ramp curves, applied to the register scale (0.5 dB steps for the DAC)
+ */
+typedef enum
+{
+  CODEC_RAMP_LINEAR, /**< Constant dB per step */
+  CODEC_RAMP_SMOOTH, /**< Slow start and end (smoothstep) */
+  CODEC_RAMP_FAST    /**< Fast start, slow end */
+} CODEC_RAMP_CURVE_E;
+
+/**
+ * @brief Creates the ramp timer and worker task
+ *
+ * @return TRUE on success
+ */
+BOOLEAN codec_ramp_init(void);
+
+/**
+ * @brief Ramps a gain register from its current value to a target
+ *
+ * A ramp already running is cancelled and the new one starts from the last
+ * value written. Supported registers are CODEC_REG_DAC_ATTEN and
+ * CODEC_REG_ADC_LEVEL (both channels move together).
+ *
+ * @param[in] reg The gain register
+ * @param[in] target The final value (ADC: level of one channel, 0x0 to 0xF)
+ * @param[in] duration_ms The ramp duration; 0 writes the target at once
+ * @param[in] curve The ramp curve
+ *
+ * @return TRUE if the ramp was started
+ */
+BOOLEAN codec_ramp_start(UINT8 reg, UINT8 target, UINT32 duration_ms, CODEC_RAMP_CURVE_E curve);
+
+/**
+ * @brief Cancels the running ramp; steps already queued are dropped
+ *
+ * The register keeps the last value written.
+ */
+void codec_ramp_cancel(void);
+
+/**
+ * @brief Tells whether a ramp is running
+ *
+ * @return TRUE while steps are still to be written
+ */
+BOOLEAN codec_ramp_busy(void);
+
+#endif /* HDR_CODEC_RAMP_H_ */
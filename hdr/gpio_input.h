@@ -0,0 +1,36 @@
+/**
+ * @file gpio_input.h
+ * @version 1.0.0
+ * @date 19/10/2026
+ *
+ * @brief Push-to-play GPIO inputs
+ *
+ * Each input is a GPIO with pull-up whose falling edge raises an interrupt.
+ * The edge (re)starts a one-shot m2mb_hwTmr debounce timer; when the timer
+ * expires, the reactor task (azx_reactor.h) reads the pin and, if it is still
+ * low, sends the clip bound to the input to the audio service queue with the
+ * time of the first edge, so that the service can record the edge to AT#APLAY
+ * latency.
+ */
+
+#ifndef HDR_GPIO_INPUT_H_
+#define HDR_GPIO_INPUT_H_
+#include "m2mb_types.h"
+
+/** Maximum number of inputs */
+#define GPIO_INPUT_MAX 4
+
+/** Time the pin must stay quiet after the last edge, in microseconds */
+#define GPIO_INPUT_DEBOUNCE_US 20000
+
+/**
+ * @brief Configures a GPIO as push-to-play input
+ *
+ * @param[in] gpio The GPIO number, as in /dev/GPIOn
+ * @param[in] file The clip to play on a press, as known to AT#APLAY
+ *
+ * @return TRUE if the input interrupt is armed
+ */
+BOOLEAN gpio_input_add(UINT8 gpio, const CHAR *file);
+
+#endif /* HDR_GPIO_INPUT_H_ */
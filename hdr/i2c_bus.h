@@ -0,0 +1,107 @@
+/**
+ * @file i2c_bus.h
+ * @version 1.0.0
+ * @date 19/10/2026
+ *
+ * @brief I2C bus transaction scheduler
+ *
+ * A single task owns the bus. Drivers register their device once, then
+ * submit write or combined write-read transactions from any task; the call
+ * blocks until the scheduler has executed it.
+ *
+ * Pending transactions are served by priority class first, and within a
+ * batch the ones for the same slave address are executed back to back, so
+ * the bus session is switched once per device.
+ *
+ * The backend is the Linux i2c-dev interface on I2C_BUS_DEV, the hardware
+ * bus the MAX9860 is wired to. The m2mb_i2c backend, bit-banged on two
+ * GPIOs, is opt-in: it is built with I2C_BUS_M2MB defined and needs the
+ * I2C_BUS_SDA_PIN / I2C_BUS_SCL_PIN of the board (I2C_BUS_BACKEND and the
+ * pin settings in Makefile.in).
+ *
+ * For each device the scheduler reports the time spent on the bus
+ * (`<name>.bus_us` counter) and the queueing delay (`<name>.queue_us`
+ * histogram); i2c_bus_log_stats() turns them into a utilization figure.
+ */
+
+#ifndef HDR_I2C_BUS_H_
+#define HDR_I2C_BUS_H_
+#include "m2mb_types.h"
+
+/** i2c-dev control file of the bus */
+#define I2C_BUS_DEV "/dev/i2c-4"
+
+/* m2mb_i2c backend pin mapping (GPIO numbers of SDA and SCL): there is no
+ * sensible default, they must come from the board schematic */
+#if defined(I2C_BUS_M2MB) && (!defined(I2C_BUS_SDA_PIN) || !defined(I2C_BUS_SCL_PIN))
+#error The m2mb_i2c backend needs I2C_BUS_SDA_PIN and I2C_BUS_SCL_PIN
+#endif
+
+/** Maximum number of devices on the bus */
+#define I2C_BUS_MAX_DEVS 4
+
+/** Maximum number of transactions in flight, all callers together */
+#define I2C_BUS_SLOTS 16
+
+/** Maximum number of transactions executed per scheduling round */
+#define I2C_BUS_BATCH 8
+
+/**
+ * @brief Priority classes, highest first
+ */
+typedef enum
+{
+  I2C_BUS_PRIO_AUDIO,  /**< Audio path: codec configuration and gain steps */
+  I2C_BUS_PRIO_SENSOR, /**< Everything that can wait */
+  I2C_BUS_PRIO_MAX
+} I2C_BUS_PRIO_E;
+
+/**
+ * @brief Creates the scheduler task
+ *
+ * @return TRUE on success, or if already running
+ */
+BOOLEAN i2c_bus_init(void);
+
+/**
+ * @brief Registers a device on the bus
+ *
+ * Registering the same name again returns the existing device.
+ *
+ * @param[in] name Short device name, used as metrics prefix; must stay valid
+ * @param[in] addr 7 bit slave address
+ * @param[in] prio Priority class of all the device's transactions
+ *
+ * @return The device id, -1 if the device table is full
+ */
+INT32 i2c_bus_register(const CHAR *name, UINT8 addr, I2C_BUS_PRIO_E prio);
+
+/**
+ * @brief Executes a transaction and waits for its completion
+ *
+ * With rlen 0 this is a plain write, otherwise a combined write-read with a
+ * repeated start. On failure the device session is reopened on next use.
+ *
+ * @param[in] dev Device id from i2c_bus_register()
+ * @param[in] wr Bytes to write, starting with the register address
+ * @param[in] wlen Number of bytes to write
+ * @param[out] rd Buffer for the bytes read, NULL if rlen is 0
+ * @param[in] rlen Number of bytes to read
+ *
+ * @return TRUE on success
+ */
+BOOLEAN i2c_bus_xfer(INT32 dev, const UINT8 *wr, UINT16 wlen, UINT8 *rd, UINT16 rlen);
+
+/**
+ * @brief Closes the bus session of a device; it is reopened on next use
+ *
+ * @param[in] dev Device id from i2c_bus_register()
+ */
+void i2c_bus_reset(INT32 dev);
+
+/**
+ * @brief Logs per-device bus utilization and queueing delay
+ */
+void i2c_bus_log_stats(void);
+
+#endif /* HDR_I2C_BUS_H_ */
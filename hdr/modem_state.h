@@ -0,0 +1,137 @@
+/**
+ * @file modem_state.h
+ * @version 1.0.0
+ * @date 19/10/2026
+ *
+ * @brief Model of the modem settings managed by the application
+ *
+ * Keeps the current value of each managed setting, learnt from one batched
+ * query at startup (modem_state_query() / modem_state_parse()) and from the
+ * commands sent through this module. A command that would set a setting to
+ * the value it already holds is not sent at all.
+ *
+ * Settings documented as mandatory after power-on (AT#DVI) are always sent.
+ * A setting whose command failed goes back to unknown, so the next request
+ * sends it again.
+ *
+ * Settings that the modem keeps across power cycles (AT$GPSP, saved with
+ * AT$GPSSAV) can be stored in a snapshot file together with a hash of the
+ * configuration that produced them: when the hash still matches at the next
+ * boot, modem_state_load() restores them and the one-time configuration can
+ * be skipped without any modem traffic.
+ */
+
+#ifndef HDR_MODEM_STATE_H_
+#define HDR_MODEM_STATE_H_
+#include "m2mb_types.h"
+#include "app_cfg.h"
+
+/** File holding the snapshot of the persistent settings */
+#define MODEM_STATE_SNAPSHOT_FILE LOCALPATH "/modem_state.bin"
+
+/** Longest value of a setting, terminator included */
+#define MODEM_STATE_VALUE_LEN 12
+
+/**
+ * @brief Managed settings
+ */
+typedef enum
+{
+  MODEM_STATE_GPSP,  /**< GNSS power, AT$GPSP; persistent once saved with AT$GPSSAV */
+  MODEM_STATE_VAUX,  /**< VAUX1 supply, AT#VAUX=1,<value> */
+  MODEM_STATE_ECHO,  /**< Command echo, ATE<value> */
+  MODEM_STATE_DVI,   /**< Digital voice interface, AT#DVI; mandatory after power-on */
+  MODEM_STATE_MAX
+} MODEM_STATE_E;
+
+/**
+ * @brief Gets the batched query reading every queryable setting in one round trip
+ *
+ * @return The command line, to be sent as is
+ */
+const CHAR *modem_state_query(void);
+
+/**
+ * @brief Updates the model from the response to modem_state_query()
+ *
+ * Settings missing from the response stay unknown. The echo setting is
+ * deduced from the presence of the echoed command line.
+ *
+ * @param[in] rsp The response
+ */
+void modem_state_parse(const CHAR *rsp);
+
+/**
+ * @brief Gets the command setting a value, unless it would change nothing
+ *
+ * When a command is returned, report its outcome with modem_state_done().
+ *
+ * @param[in] setting The setting
+ * @param[in] value The wanted value, as written in the set command
+ *
+ * @return The command line to send, NULL if the modem already holds value
+ */
+const CHAR *modem_state_cmd(MODEM_STATE_E setting, const CHAR *value);
+
+/**
+ * @brief Reports the outcome of a command returned by modem_state_cmd()
+ *
+ * @param[in] setting The setting
+ * @param[in] ok TRUE if the modem accepted the command
+ */
+void modem_state_done(MODEM_STATE_E setting, BOOLEAN ok);
+
+/**
+ * @brief Sets a value with a blocking AT command, unless it would change nothing
+ *
+ * @param[in] instance The ATI instance
+ * @param[in] setting The setting
+ * @param[in] value The wanted value, as written in the set command
+ * @param[out] sent Optional, set to TRUE if a command was actually sent
+ *
+ * @return TRUE if the modem holds value
+ */
+BOOLEAN modem_state_set(INT16 instance, MODEM_STATE_E setting, const CHAR *value, BOOLEAN *sent);
+
+/**
+ * @brief Forgets the value of a setting, e.g. after a modem reset
+ *
+ * @param[in] setting The setting, MODEM_STATE_MAX for all
+ */
+void modem_state_invalidate(MODEM_STATE_E setting);
+
+/**
+ * @brief Hashes a configuration description
+ *
+ * The snapshot format version is part of the hash, so a format change
+ * invalidates the snapshots written by older builds.
+ *
+ * @param[in] cfg Any string describing the one-time configuration, e.g. the
+ *     commands it sends
+ *
+ * @return The hash to pass to modem_state_load() and modem_state_save()
+ */
+UINT32 modem_state_hash(const CHAR *cfg);
+
+/**
+ * @brief Restores the persistent settings from the snapshot file
+ *
+ * @param[in] cfg_hash Hash of the configuration the application wants
+ *
+ * @return TRUE if the snapshot exists, is valid and was written for the same
+ *     configuration: the one-time configuration can be skipped
+ */
+BOOLEAN modem_state_load(UINT32 cfg_hash);
+
+/**
+ * @brief Writes the known persistent settings to the snapshot file
+ *
+ * Call it once the one-time configuration has been applied successfully.
+ *
+ * @param[in] cfg_hash Hash of the configuration just applied
+ *
+ * @return TRUE if the file was written
+ */
+BOOLEAN modem_state_save(UINT32 cfg_hash);
+
+#endif /* HDR_MODEM_STATE_H_ */
@@ -0,0 +1,57 @@
+/**
+ * @file playlist.h
+ * @version 1.0.0
+ * @date 19/10/2026
+ *
+ * @brief Playlist of audio clips for the audio service
+ *
+ * A small FIFO of file names, each with a cached validation result so the
+ * next clip can be checked while the current one is still playing. It is
+ * only used from the audio service task and is not thread safe.
+ */
+
+#ifndef HDR_PLAYLIST_H_
+#define HDR_PLAYLIST_H_
+#include "m2mb_types.h"
+#include "audio_svc.h"
+
+/** Maximum number of queued clips */
+#define PLAYLIST_LEN 8
+
+/**
+ * @brief Appends a clip at the end of the playlist
+ *
+ * @param[in] file The audio file name
+ *
+ * @return FALSE if the playlist is full
+ */
+BOOLEAN playlist_push(const CHAR *file);
+
+/**
+ * @brief Returns the next clip to play, skipping the ones that failed validation
+ *
+ * Clips that have not been validated yet are validated now.
+ *
+ * @return The file name, NULL if the playlist is empty. Valid until playlist_pop().
+ */
+const CHAR* playlist_peek(void);
+
+/**
+ * @brief Removes the clip returned by playlist_peek()
+ */
+void playlist_pop(void);
+
+/**
+ * @brief Removes all the clips
+ */
+void playlist_clear(void);
+
+/**
+ * @brief Validates the next clip ahead of time
+ *
+ * Meant to be called while the current clip is playing, so that starting
+ * the next one does not pay for the check.
+ */
+void playlist_prefetch(void);
+
+#endif /* HDR_PLAYLIST_H_ */
@@ -1,142 +1,295 @@
-#include "m2mb_types.h"
-#include <linux/i2c-dev.h>
-#include <sys/ioctl.h>
-#include <sys/types.h>
-#include <fcntl.h>
-#include <unistd.h>
+#include <stdio.h>
 #include <string.h>
+#include "m2mb_types.h"
 #include "azx_log.h"
+#include "azx_utils.h"
 #include "m2mb_os_api.h"
 #include "at_utils.h"
+#include "at_batch.h"
+#include "boot_prof.h"
+#include "app_cfg.h"
+#include "audio_svc.h"
+#include "gpio_input.h"
+#include "modem_state.h"
+
+/* The one-time configuration: the settings applied unless the modem already
+ * holds them, then, if any was sent, the commands making them persistent. The
+ * commands and the hash of the modem state snapshot are both built from these
+ * tables, so an edit here is applied again on the next boot */
+static const struct
+{
+  MODEM_STATE_E setting;
+  const CHAR *value;
+} boot_once_set[] =
+{
+  { MODEM_STATE_GPSP, "1" },
+};
+
+static const CHAR *const boot_once_then[] =
+{
+  "AT$GPSSAV\r",
+};
+
+#define BOOT_ONCE_SETTINGS (sizeof(boot_once_set) / sizeof(boot_once_set[0]))
+#define BOOT_ONCE_THEN (sizeof(boot_once_then) / sizeof(boot_once_then[0]))
+#define BOOT_ONCE_MAX (BOOT_ONCE_SETTINGS + BOOT_ONCE_THEN)
+
+/* Longest wait for the AT exchanges of the boot sequence: past it, the boot goes on
+ * without the one-time configuration rather than waiting for a modem that is stuck */
+#define BOOT_AT_WAIT_MS 180000
+#define BOOT_AT_POLL_MS 1000
 
-static UINT8 sendAT(char *cmd);
-static BOOLEAN on_codec(void);
-static BOOLEAN send_to_codec(char *str);
-static int char2int(char input);
-static int hex2bin(const char* src, char* target);
+/* Boot sequence state: locals do not survive a coroutine wait */
+static struct
+{
+  CHAR rsp[AT_BATCH_RSP_LEN];
+  CHAR line[AT_BATCH_LINE_MAX];
+  AT_BATCH_CMD_T once[BOOT_ONCE_MAX];
+  UINT32 once_set[BOOT_ONCE_SETTINGS];  /* entry of boot_once_set[] of each setting sent */
+  UINT32 settings;
+  UINT32 count;
+  UINT32 i;  /* first command of the line in progress */
+  UINT32 n;  /* number of commands in that line */
+  UINT32 j;  /* command resent on its own */
+  const CHAR *cmd;
+  M2MB_RESULT_E res;
+  BOOLEAN ok;
+  BOOLEAN once_ok;
+  volatile BOOLEAN done;
+} boot;
+
+static AZX_PT_T boot_pt;
+static M2MB_OS_SEM_HANDLE boot_sem = NULL;
 static INT16 instanceID = 0; /*AT0, bound to UART by default config*/
-static CHAR rsp[100];
-static M2MB_RESULT_E retVal;
-
-static int char2int(char input) {
-    if(input >= '0' && input <= '9') return input - '0';
-    if(input >= 'A' && input <= 'F') return input - 'A' + 10;
-    if(input >= 'a' && input <= 'f') return input - 'a' + 10;
-    return -1;
-}
 
-// This function assumes src to be a zero terminated sanitized string with
-// an even number of [0-9a-f] characters, and target to be sufficiently large
-static int hex2bin(const char* src, char* target) {
-    while(src[0] && src[1]) {
-        int a = char2int(src[0]);
-        int b = char2int(src[1]);
-        if (a < 0 || b < 0) return -1;
-        *(target++) = a*16 + b;
-        src += 2;
-    }
-    return 0;
-}
+static UINT32 boot_once_hash(void);
+static BOOLEAN boot_wait(void);
+static void boot_at_done(M2MB_RESULT_E result, void *arg);
+static M2MB_RESULT_E boot_at_send(AZX_PT_T *pt, const CHAR *cmd);
+static AZX_PT_RESULT_E boot_seq(AZX_PT_T *pt, void *ctx);
+
+/* Hash of the one-time configuration tables, for the modem state snapshot */
+static UINT32 boot_once_hash(void) {
+    CHAR cfg[AT_BATCH_LINE_MAX * 2];
+    UINT32 i, len = 0;
 
-static BOOLEAN on_codec(void) {
-    const char *req = "AT#DVI=1,2,1\r";
-    retVal= send_async_at_command(instanceID,req,rsp, sizeof(rsp)); // эту команду нужно отправлять всегда после включения, даже если модем уже так сконфигурирован
-    if ( retVal != M2MB_RESULT_SUCCESS )
+    for ( i = 0; i < BOOT_ONCE_SETTINGS && len < sizeof(cfg); i++ )
     {
-        AZX_LOG_ERROR( "Error sending command <%s>r\n", req);
-        return FALSE;
+        len += snprintf(cfg + len, sizeof(cfg) - len, "%u=%s;", (UINT32)boot_once_set[i].setting,
+                        boot_once_set[i].value);
     }
-    else
+    for ( i = 0; i < BOOT_ONCE_THEN && len < sizeof(cfg); i++ )
     {
-        AZX_LOG_INFO("Command response: <%s>\r\n\r\n", rsp);
-        return TRUE;
+        len += snprintf(cfg + len, sizeof(cfg) - len, "%s", boot_once_then[i]);
     }
+    return modem_state_hash(cfg);
 }
 
-static BOOLEAN send_to_codec(char *str) {
-    const int addr = 0x10;
-    int i2c_fd = 0;
-    char data[128];
-    memset(data,0,128);
-    if (hex2bin(str, data) < 0) {
-        return FALSE;
-    }
-    // Open a connection to the I2C userspace control file.
-    if ((i2c_fd = open("/dev/i2c-4", O_RDWR)) < 0) {
-        AZX_LOG_ERROR("[I2C] Unable to open i2c_4 control file");
-        return FALSE;
-    }
-    if (ioctl(i2c_fd, I2C_SLAVE, addr) < 0) {
-        AZX_LOG_ERROR("[I2C] Unable to set slave addr");
-        close(i2c_fd);
-        return FALSE;
-    }
-    int len = strlen(str)/2;
-    AZX_LOG_DEBUG("writing to i2c %s : %d bytes", str, len);
-    if (write(i2c_fd, data, len) != len) {
-        AZX_LOG_ERROR("Failed to write to the i2c bus");
-        close(i2c_fd);
-        return FALSE;
+/* Waits for the boot coroutine: TRUE once it has signalled boot_sem, FALSE if it
+ * ended without doing so (a sleep failed) or BOOT_AT_WAIT_MS went by */
+static BOOLEAN boot_wait(void) {
+    UINT32 waited;
+
+    for ( waited = 0; waited < BOOT_AT_WAIT_MS; waited += BOOT_AT_POLL_MS )
+    {
+        if ( m2mb_os_sem_get(boot_sem, M2MB_OS_MS2TICKS(BOOT_AT_POLL_MS)) == M2MB_OS_SUCCESS )
+        {
+            return TRUE;
+        }
+        if ( !azx_pt_running(&boot_pt) )
+        {
+            return m2mb_os_sem_get(boot_sem, M2MB_OS_NO_WAIT) == M2MB_OS_SUCCESS;
+        }
     }
-    close(i2c_fd);
-    return TRUE;
+    return FALSE;
 }
 
-static UINT8 sendAT(char *cmd) {
-    retVal = send_async_at_command(instanceID, cmd, rsp, sizeof(rsp));
-    if ( retVal != M2MB_RESULT_SUCCESS )
+static void boot_at_done(M2MB_RESULT_E result, void *arg) {
+    boot.ok = (result == M2MB_RESULT_SUCCESS && strstr(boot.rsp, "OK") != NULL);
+    if ( !boot.ok )
     {
-        AZX_LOG_ERROR( "Error sending command <%s>\n", cmd);
-        return FALSE;
+        AZX_LOG_ERROR( "Error sending command <%s>\n", boot.cmd);
     }
     else
     {
-        AZX_LOG_INFO("Command response: <%s>\r\n\r\n", rsp);
-        return TRUE;
+        AZX_LOG_INFO("Command response: <%s>\r\n\r\n", boot.rsp);
     }
+    boot.done = TRUE;
+    azx_pt_wake((AZX_PT_T *)arg);
 }
 
-// CODEC > MAX9860
-void M2MB_main( int argc, char **argv ) {
-  (void)argc;
-  (void)argv;
+/* Starts a command without blocking; boot.done is set once it completes or fails.
+ * M2MB_RESULT_SM_UNAVAILABLE means the instance is busy: retry later */
+static M2MB_RESULT_E boot_at_send(AZX_PT_T *pt, const CHAR *cmd) {
+    M2MB_RESULT_E retVal;
 
-  m2mb_os_taskSleep( M2MB_OS_MS2TICKS(2000) );
-//    AZX_LOG_INIT();
-    AZX_LOG_INFO("Starting AT demo app. This is v%s built on %s %s.\r\n",
-                 VERSION, __DATE__, __TIME__);
+    boot.cmd = cmd;
+    boot.done = FALSE;
+    retVal = at_cmd_async_submit(instanceID, cmd, boot.rsp, sizeof(boot.rsp), boot_at_done, pt, NULL);
+    if ( retVal != M2MB_RESULT_SUCCESS && retVal != M2MB_RESULT_SM_UNAVAILABLE )
+    {
+        AZX_LOG_ERROR( "Error sending command <%s>\n", cmd);
+        boot.ok = FALSE;
+        boot.done = TRUE;
+    }
+    return retVal;
+}
+
+/* The AT exchanges of the boot sequence, run as a coroutine on the reactor task: the
+ * waits do not hold a task. Everything that blocks (file I/O, ATI setup) stays on the
+ * main task, which waits on boot_sem for the end of the coroutine */
+static AZX_PT_RESULT_E boot_seq(AZX_PT_T *pt, void *ctx) {
+    const CHAR *cmd;
+    UINT32 i;
+    (void)ctx;
 
-    retVal = at_cmd_async_init(instanceID);
-    if ( retVal == M2MB_RESULT_SUCCESS )
+    AZX_PT_BEGIN(pt);
+    /* One round trip reads the settings managed by the state model */
+    while ( (boot.res = boot_at_send(pt, modem_state_query())) == M2MB_RESULT_SM_UNAVAILABLE )
     {
-        AZX_LOG_TRACE( "at_cmd_sync_init() returned success value\r\n" );
+        AZX_PT_SLEEP_MS(pt, 20);
     }
-    else
+    AZX_PT_WAIT_UNTIL(pt, boot.done);
+    if ( boot.ok )
     {
-        AZX_LOG_ERROR( "at_cmd_sync_init() returned failure value\r\n" );
-        return;
+        modem_state_parse(boot.rsp);
     }
-    sendAT("AT$GPSP=1\r");
-    sendAT("AT$GPSSAV\r");
-    sendAT("AT#VAUX=1,1\r");
-    sendAT("AT#GPIO=7,1,1\r");
-    on_codec();
-    send_to_codec("0220101000242000003300540000008b");
-    for (int i = 0; i < 10; i++){
-        m2mb_os_taskSleep( M2MB_OS_MS2TICKS(250) );
-        sendAT("ATE0\r");
+
+    /* The one-time settings only when they actually change, followed by the
+     * commands saving them, on as few command lines as possible */
+    memset(boot.once, 0, sizeof(boot.once));
+    boot.count = 0;
+    for ( i = 0; i < BOOT_ONCE_SETTINGS; i++ )
+    {
+        cmd = modem_state_cmd(boot_once_set[i].setting, boot_once_set[i].value);
+        if ( cmd )
+        {
+            boot.once_set[boot.count] = i;
+            boot.once[boot.count++].cmd = cmd;
+        }
     }
-    sendAT("AT#APLAY=1,0,\"one_tone.wav\"\r");
-    m2mb_os_taskSleep( M2MB_OS_MS2TICKS(2000) );
-    retVal = at_cmd_async_deinit(instanceID);
-    if ( retVal == M2MB_RESULT_SUCCESS )
+    boot.settings = boot.count;
+    if ( boot.settings > 0 )
     {
-        AZX_LOG_TRACE( "at_cmd_async_deinit() returned success value\r\n" );
+        for ( i = 0; i < BOOT_ONCE_THEN; i++ )
+        {
+            boot.once[boot.count++].cmd = boot_once_then[i];
+        }
     }
-    else
+    /* As at_batch_send(), without blocking: a failed line is sent again one
+     * command at a time, since the modem does not tell which one failed */
+    for ( boot.i = 0; boot.i < boot.count; boot.i += boot.n )
+    {
+        boot.n = at_batch_compile(&boot.once[boot.i], boot.count - boot.i, boot.line, sizeof(boot.line));
+        if ( boot.n == 0 )
+        {
+            AZX_LOG_ERROR( "Command too long: %s\n", boot.once[boot.i].cmd);
+            boot.n = 1;
+            continue;
+        }
+        while ( (boot.res = boot_at_send(pt, boot.line)) == M2MB_RESULT_SM_UNAVAILABLE )
+        {
+            AZX_PT_SLEEP_MS(pt, 20);
+        }
+        AZX_PT_WAIT_UNTIL(pt, boot.done);
+        at_batch_split(boot.ok ? boot.rsp : "", &boot.once[boot.i], boot.n);
+        if ( boot.n > 1 && !boot.once[boot.i].ok )
+        {
+            AZX_LOG_WARN("Batch failed, sending its commands one by one\r\n");
+            for ( boot.j = boot.i; boot.j < boot.i + boot.n; boot.j++ )
+            {
+                while ( (boot.res = boot_at_send(pt, boot.once[boot.j].cmd)) == M2MB_RESULT_SM_UNAVAILABLE )
+                {
+                    AZX_PT_SLEEP_MS(pt, 20);
+                }
+                AZX_PT_WAIT_UNTIL(pt, boot.done);
+                boot.once[boot.j].ok = boot.ok;
+            }
+        }
+    }
+    boot.once_ok = TRUE;
+    for ( i = 0; i < boot.count; i++ )
     {
-        AZX_LOG_ERROR( "at_cmd_async_deinit() returned failure value\r\n" );
-        return;
+        boot.once_ok = boot.once_ok && boot.once[i].ok;
     }
+    for ( i = 0; i < boot.settings; i++ )
+    {
+        modem_state_done(boot_once_set[boot.once_set[i]].setting, boot.once[i].ok);
+    }
+    m2mb_os_sem_put(boot_sem);
+    AZX_PT_END(pt);
 }
 
+// CODEC > MAX9860
+void M2MB_main( int argc, char **argv ) {
+  M2MB_OS_SEM_ATTR_HANDLE semAttrHandle;
+  (void)argc;
+  (void)argv;
+
+  boot_prof_init();
+  boot_prof_begin(BOOT_PROF_INITIAL_SLEEP);
+  azx_sleep_ms(2000);
+  boot_prof_end(BOOT_PROF_INITIAL_SLEEP);
+//  AZX_LOG_INIT();
+  AZX_LOG_INFO("Starting AT demo app. This is v%s built on %s %s.\r\n",
+               VERSION, __DATE__, __TIME__);
+
+  boot_prof_begin(BOOT_PROF_ATI_INIT);
+  if ( at_cmd_async_init(instanceID) != M2MB_RESULT_SUCCESS )
+  {
+      boot_prof_end(BOOT_PROF_ATI_INIT);
+      AZX_LOG_ERROR( "at_cmd_async_init() returned failure value\r\n" );
+      return;
+  }
+  /* Urgent commands (stopping the playback) get an instance of their own */
+  if ( at_cmd_async_init(AT_URGENT_INSTANCE) != M2MB_RESULT_SUCCESS )
+  {
+      AZX_LOG_WARN( "No reserved instance, urgent commands share AT%d\r\n", instanceID );
+  }
+  boot_prof_end(BOOT_PROF_ATI_INIT);
+  AZX_LOG_TRACE( "at_cmd_async_init() returned success value\r\n" );
+
+  /* Fast path: the snapshot says the modem already holds the one-time
+   * configuration, a single file read replaces the whole block */
+  boot_prof_begin(BOOT_PROF_GPS_CFG);
+  if ( modem_state_load(boot_once_hash()) )
+  {
+      AZX_LOG_INFO("One-time configuration already applied\r\n");
+  }
+  else
+  {
+      m2mb_os_sem_setAttrItem( &semAttrHandle, CMDS_ARGS( M2MB_OS_SEM_SEL_CMD_CREATE_ATTR,  NULL,M2MB_OS_SEM_SEL_CMD_COUNT, 0, M2MB_OS_SEM_SEL_CMD_TYPE, M2MB_OS_SEM_BINARY,M2MB_OS_SEM_SEL_CMD_NAME, "BootSem"));
+      m2mb_os_sem_init( &boot_sem, &semAttrHandle );
+      if ( !azx_pt_start(&boot_pt, boot_seq, NULL) )
+      {
+          AZX_LOG_ERROR( "Cannot start the boot sequence\r\n" );
+          return;
+      }
+      if ( !boot_wait() )
+      {
+          /* The coroutine may still finish later: boot_sem is kept for it */
+          AZX_LOG_ERROR( "One-time configuration not done\r\n" );
+      }
+      else
+      {
+          m2mb_os_sem_deinit(boot_sem);
+          if ( boot.once_ok && !modem_state_save(boot_once_hash()) )
+          {
+              AZX_LOG_WARN("Cannot save the modem state snapshot\r\n");
+          }
+      }
+  }
+  boot_prof_end(BOOT_PROF_GPS_CFG);
+
+  /* The audio service keeps the ATI instance and the codec warm from now on:
+   * the instance is never deinitialized. */
+  if ( !audio_svc_start(instanceID) )
+  {
+      AZX_LOG_ERROR( "audio_svc_start() returned failure value\r\n" );
+      return;
+  }
+  audio_svc_play("one_tone.wav");
+#if TRIGGER_GPIO > 0
+  gpio_input_add(TRIGGER_GPIO, TRIGGER_FILE);
+#endif
+}
@@ -32,44 +32,388 @@
 #include "m2mb_ati.h"
 
 #include "azx_log.h"
+#include "azx_utils.h"
+#include "azx_trace.h"
+#include "azx_metrics.h"
+#include "azx_timer.h"
+
+#include "at_utils.h"
+#include "at_cache.h"
+#include "at_timeout.h"
 
 
 /* Local defines ================================================================================*/
 #define MIN(X, Y) (((X) < (Y)) ? (X) : (Y))
-#define AT_RSP_TIMEOUT 120000
+#define AT_URC_BUF_SIZE 128
+#define AT_INSTANCES 2
+#define AT_MAX_WAITERS 8      /* tasks waiting for an instance, at most 32 */
+#define AT_PRIO_AGING_MS 2000 /* waiting this long is worth one priority class */
+#define AT_RESYNC_MS 2000     /* wait for the late end of an abandoned command */
 
 /* Local typedefs ===============================================================================*/
+typedef struct
+{
+  M2MB_ATI_HANDLE handle;
+  M2MB_OS_SEM_HANDLE rsp_sem;  /* given by the callback when the parser goes back to IDLE */
+  int state;
+  BOOLEAN busy;                /* a command owns the instance */
+  volatile UINT32 running_id;  /* command in the parser, 0 if none */
+  volatile BOOLEAN need_resync; /* a command was abandoned: recover before the next one */
+  volatile BOOLEAN recovering;  /* at_recover() waits for the late IDLE */
+  UINT64 resync_us;             /* when need_resync was set */
+} AT_INSTANCE_T;
+
+typedef struct
+{
+  BOOLEAN used;
+  INT16 instance;
+  AT_PRIO_E prio;
+  UINT64 since_us;
+} AT_WAITER_T;
 
 /* Local statics ================================================================================*/
 
 static unsigned char g_at_rsp_buf[4096];
 
-static M2MB_ATI_HANDLE ati_handles[2];
+static AT_INSTANCE_T ati[AT_INSTANCES];
+static volatile UINT32 next_id = 0;
 
-static M2MB_OS_SEM_HANDLE at_rsp_sem = NULL;
+/* Ownership of the instances: free instances are taken at once, busy ones are handed
+ * over by the owner to the best waiter, woken through its own event bit */
+static M2MB_OS_SEM_HANDLE arb_lock = NULL;
+static M2MB_OS_EV_HANDLE arb_ev = NULL;
+static AT_WAITER_T waiters[AT_MAX_WAITERS];
 
-static int ati_state = M2MB_STATE_IDLE_EVT;
+static at_urc_cb urc_cb = NULL;
+static CHAR urc_buf[AT_URC_BUF_SIZE];
+
+/* Command sent by at_cmd_async_submit(), completed from the ATI callback */
+static struct
+{
+  volatile UINT32 active;  /* ID of the command, 0 if none: cleared once, by CAS */
+  INT16 instance;
+  CHAR *rsp;
+  UINT32 rsp_len;
+  at_done_cb cb;
+  void *arg;
+  UINT64 start_us;
+  AT_TMO_CLASS_E cls;
+  AZX_TIMER_T deadline;
+} at_pending;
+
+static struct
+{
+  AZX_METRIC_T *sent;
+  AZX_METRIC_T *errors;
+  AZX_METRIC_T *timeouts;
+  AZX_METRIC_T *resyncs;
+  AZX_METRIC_T *stale;
+  AZX_METRIC_T *rx_bytes;
+  AZX_METRIC_T *latency_ms;
+  AZX_METRIC_T *urgent_wait_us;
+} at_metrics;
 
 /* Local function prototypes ====================================================================*/
+static INT32 at_cs_next(INT16 instance);
+static M2MB_RESULT_E at_cs_get(INT16 instance, AT_PRIO_E prio, BOOLEAN wait);
+static void at_cs_put(INT16 instance);
+static UINT32 at_new_id(void);
+static void at_recover(INT16 instance, UINT32 wait_ms);
+static void at_cmd_async_callback ( M2MB_ATI_HANDLE h, M2MB_ATI_EVENTS_E ati_event, UINT16 resp_size, void *resp_struct, void *userdata );
+static BOOLEAN at_pending_complete(UINT32 id, M2MB_RESULT_E result);
+static void at_pending_timeout(void *arg);
+
 /* Static functions =============================================================================*/
+/*-----------------------------------------------------------------------------------------------*/
+/*!
+  \brief Picks the waiter to hand an instance over to, called with arb_lock held
+
+  Lower class first. Waiting ages the interactive and background classes up to the
+  interactive level, so background commands cannot starve but never overtake an
+  urgent one. Among equals the oldest waiter wins.
+
+  \return The waiter slot, -1 if nobody waits for the instance
+ */
+/*-----------------------------------------------------------------------------------------------*/
+static INT32 at_cs_next(INT16 instance)
+{
+  INT32 best = -1;
+  INT64 best_score = 0;
+  INT64 score;
+  UINT32 i;
+
+  for(i = 0; i < AT_MAX_WAITERS; i++)
+  {
+    if(!waiters[i].used || waiters[i].instance != instance)
+    {
+      continue;
+    }
+    score = (INT64)waiters[i].prio * AT_PRIO_AGING_MS;
+    if(waiters[i].prio != AT_PRIO_URGENT)
+    {
+      score -= (INT64)azx_elapsed_ms(waiters[i].since_us);
+      if(score < AT_PRIO_AGING_MS)
+      {
+        score = AT_PRIO_AGING_MS;
+      }
+    }
+    if(best < 0 || score < best_score ||
+        (score == best_score && waiters[i].since_us < waiters[best].since_us))
+    {
+      best = (INT32)i;
+      best_score = score;
+    }
+  }
+  return best;
+}
+
+/*-----------------------------------------------------------------------------------------------*/
+/*!
+  \brief Takes the ownership of an instance (critical section enter)
+
+  Without wait, it never blocks: an instance still to be recovered from an abandoned command
+  is reported busy, the recovery being left to the late IDLE event or to a blocking owner.
+
+  \return M2MB_RESULT_SM_UNAVAILABLE if the instance is busy and wait is FALSE
+ */
+/*-----------------------------------------------------------------------------------------------*/
+static M2MB_RESULT_E at_cs_get(INT16 instance, AT_PRIO_E prio, BOOLEAN wait)
+{
+  UINT32 flags;
+  INT32 slot;
+  UINT64 start_us = azx_clock_us();
+
+  for(;;)
+  {
+    m2mb_os_sem_get(arb_lock, M2MB_OS_WAIT_FOREVER);
+    if(!ati[instance].busy)
+    {
+      ati[instance].busy = TRUE;
+      m2mb_os_sem_put(arb_lock);
+      break;
+    }
+    if(!wait)
+    {
+      m2mb_os_sem_put(arb_lock);
+      return M2MB_RESULT_SM_UNAVAILABLE;
+    }
+    for(slot = 0; slot < AT_MAX_WAITERS && waiters[slot].used; slot++)
+    {
+    }
+    if(slot == AT_MAX_WAITERS)
+    {
+      /* Every slot taken: rare, poll until one is free */
+      m2mb_os_sem_put(arb_lock);
+      azx_sleep_ms(1);
+      continue;
+    }
+    waiters[slot].used = TRUE;
+    waiters[slot].instance = instance;
+    waiters[slot].prio = prio;
+    waiters[slot].since_us = azx_clock_us();
+    m2mb_os_sem_put(arb_lock);
+
+    /* The owner frees the slot and hands the instance over, still busy */
+    m2mb_os_ev_get(arb_ev, 1U << slot, M2MB_OS_EV_GET_ANY_AND_CLEAR, &flags, M2MB_OS_WAIT_FOREVER);
+    break;
+  }
+  if(ati[instance].need_resync)
+  {
+    if(wait)
+    {
+      at_recover(instance, AT_RESYNC_MS);
+    }
+    else if(AZX_CLOCK_EXPIRED(ati[instance].resync_us, (UINT64)AT_RESYNC_MS * 1000))
+    {
+      /* The late IDLE had its chance: recover now, without waiting any more */
+      at_recover(instance, 0);
+    }
+    else
+    {
+      at_cs_put(instance);
+      return M2MB_RESULT_SM_UNAVAILABLE;
+    }
+  }
+  if(prio == AT_PRIO_URGENT)
+  {
+    azx_metrics_observe(at_metrics.urgent_wait_us, azx_elapsed_us(start_us));
+  }
+  return M2MB_RESULT_SUCCESS;
+}
+
+/*-----------------------------------------------------------------------------------------------*/
+/*!
+  \brief Releases an instance to the best waiter, if any (critical section exit)
+ */
+/*-----------------------------------------------------------------------------------------------*/
+static void at_cs_put(INT16 instance)
+{
+  INT32 next;
+
+  m2mb_os_sem_get(arb_lock, M2MB_OS_WAIT_FOREVER);
+  next = at_cs_next(instance);
+  if(next >= 0)
+  {
+    waiters[next].used = FALSE;
+    m2mb_os_ev_set(arb_ev, 1U << next, M2MB_OS_EV_SET);
+  }
+  else
+  {
+    ati[instance].busy = FALSE;
+  }
+  m2mb_os_sem_put(arb_lock);
+}
+
+static UINT32 at_new_id(void)
+{
+  UINT32 id;
+
+  do
+  {
+    id = __sync_add_and_fetch(&next_id, 1);
+  } while(id == 0);
+  return id;
+}
+
+/*-----------------------------------------------------------------------------------------------*/
+/*!
+  \brief Brings an instance back to a known-good state after an abandoned command, called by
+  the owner of the instance
+
+  Waits at most wait_ms for the late end of the command, then drops its response. If the
+  parser is still busy, a new ATI session replaces the stuck one. Any IDLE signal left
+  over is dropped, so the next command cannot take it for its own.
+ */
+/*-----------------------------------------------------------------------------------------------*/
+static void at_recover(INT16 instance, UINT32 wait_ms)
+{
+  AT_INSTANCE_T *a = &ati[instance];
+  UINT64 start_us = azx_clock_us();
+  SSIZE_T len = 0;
+
+  AZX_METRICS_INC(at_metrics.resyncs);
+  a->recovering = TRUE;
+  if(a->state != M2MB_STATE_IDLE_EVT && wait_ms > 0)
+  {
+    m2mb_os_sem_get(a->rsp_sem, M2MB_OS_MS2TICKS(wait_ms));
+  }
+  if(a->state == M2MB_STATE_IDLE_EVT)
+  {
+    len = m2mb_ati_rcv_resp(a->handle, g_at_rsp_buf, sizeof(g_at_rsp_buf) - 1);
+  }
+  else
+  {
+    AZX_LOG_WARN("AT%d still busy, restarting the ATI session\r\n", instance);
+    m2mb_ati_deinit(a->handle);
+    if(m2mb_ati_init(&a->handle, instance, at_cmd_async_callback, (void*)(INT32)instance) !=
+        M2MB_RESULT_SUCCESS)
+    {
+      AZX_LOG_ERROR("m2mb_ati_init() returned failure value\r\n");
+      a->handle = NULL;
+    }
+    a->state = M2MB_STATE_IDLE_EVT;
+  }
+  a->running_id = 0;
+  while(m2mb_os_sem_get(a->rsp_sem, M2MB_OS_NO_WAIT) == M2MB_OS_SUCCESS)
+  {
+  }
+  a->need_resync = FALSE;
+  a->recovering = FALSE;
+  AZX_LOG_WARN("AT%d recovered in %u ms, %d stale bytes dropped\r\n", instance,
+      azx_elapsed_ms(start_us), (len > 0) ? (INT32)len : 0);
+}
+
+/*-----------------------------------------------------------------------------------------------*/
+/*!
+  \brief Completes the submitted command id, once: reads the response, releases the
+  critical section and calls the completion callback. Does nothing if id is no longer
+  the pending command, so completion, timeout and cancellation cannot both win
+
+  \return FALSE if the command was already completed
+ */
+/*-----------------------------------------------------------------------------------------------*/
+static BOOLEAN at_pending_complete(UINT32 id, M2MB_RESULT_E result)
+{
+  at_done_cb cb;
+  void *arg;
+
+  if(id == 0 || !__sync_bool_compare_and_swap(&at_pending.active, id, 0))
+  {
+    return FALSE;
+  }
+  azx_timer_cancel(&at_pending.deadline);
+  if(result == M2MB_RESULT_SUCCESS)
+  {
+    azx_metrics_observe(at_metrics.latency_ms, azx_elapsed_ms(at_pending.start_us));
+    at_timeout_sample(at_pending.cls, azx_elapsed_ms(at_pending.start_us));
+    memset(at_pending.rsp, 0x00, at_pending.rsp_len);
+    if(m2mb_ati_rcv_resp(ati[at_pending.instance].handle, at_pending.rsp, at_pending.rsp_len) == -1)
+    {
+      AZX_METRICS_INC(at_metrics.errors);
+      result = M2MB_RESULT_FAIL;
+    }
+  }
+  if(result == M2MB_RESULT_SUCCESS)
+  {
+    ati[at_pending.instance].running_id = 0;
+  }
+  else
+  {
+    /* Timed out or cancelled: the command may still run. Its late IDLE recovers the
+     * instance; failing that, the next owner does, at the latest AT_RESYNC_MS from now */
+    ati[at_pending.instance].resync_us = azx_clock_us();
+    ati[at_pending.instance].need_resync = TRUE;
+  }
+  cb = at_pending.cb;
+  arg = at_pending.arg;
+  at_cs_put(at_pending.instance);  /*Release CS*/
+  cb(result, arg);
+  return TRUE;
+}
+
+static void at_pending_timeout(void *arg)
+{
+  UINT32 id = (UINT32)(size_t)arg;
+
+  if(at_pending.active != id)
+  {
+    return;  /* completed or cancelled meanwhile */
+  }
+  AZX_METRICS_INC(at_metrics.timeouts);
+  AZX_LOG_ERROR("submitted command timeout!\r\n");
+  at_timeout_expired(at_pending.cls);
+  at_pending_complete(id, M2MB_RESULT_FAIL);
+}
+
 static void at_cmd_async_callback ( M2MB_ATI_HANDLE h, M2MB_ATI_EVENTS_E ati_event, UINT16 resp_size, void *resp_struct, void *userdata )
 {
-  (void)h;
-  (void)userdata;
+  INT16 instance = (INT16)(INT32)userdata;
   
   INT32 resp_len;
   INT16 resp_len_short;
   AZX_LOG_TRACE("ati callback! Event: %d; resp_size: %u\r\n", ati_event, resp_size);
+  AZX_TRACE_INSTANT_EVT("ati_cb", ati_event);
+
+  if(ati[instance].handle && h != ati[instance].handle)
+  {
+    return;  /* session replaced by at_recover() */
+  }
 
   if(ati_event == M2MB_RX_DATA_EVT )
   {
-    if(ati_state == M2MB_STATE_IDLE_EVT)
+    if(ati[instance].state == M2MB_STATE_IDLE_EVT)
     {
       
       AZX_LOG_TRACE("This is an UNSOLICITED\r\n");
-      //read and discard data
-      //m2mb_ati_rcv_resp(h, tmp_buf, 100);
-      //AZX_LOG_TRACE("UNSOLICITED: %s\r\n", tmp_buf);
+      memset(urc_buf, 0, sizeof(urc_buf));
+      if(m2mb_ati_rcv_resp(h, urc_buf, sizeof(urc_buf) - 1) > 0)
+      {
+        at_cache_urc(urc_buf);
+        if(urc_cb)
+        {
+          urc_cb(urc_buf);
+        }
+      }
     }
     else /*Normal data reception, read and append into global buffer*/
     {
@@ -84,17 +428,40 @@ static void at_cmd_async_callback ( M2MB_ATI_HANDLE h, M2MB_ATI_EVENTS_E ati_eve
         resp_len = *(INT32*)resp_struct;
       }
       AZX_LOG_DEBUG("Callback - available bytes: %d\r\n", resp_len);
+      azx_metrics_observe(at_metrics.rx_bytes, (UINT32)resp_len);
     }
   }
   else
   {
-    ati_state = ati_event;
+    ati[instance].state = ati_event;
   }
 
   if(ati_event == M2MB_STATE_IDLE_EVT) /*AT parser changed to IDLE, meaning the command execution completed.*/
   {
     AZX_LOG_TRACE("UNLOCKING AT semaphore\r\n");
-    m2mb_os_sem_put(at_rsp_sem);
+    if(!ati[instance].running_id)
+    {
+      /* End of a command already recovered from: nobody waits for it */
+      AZX_METRICS_INC(at_metrics.stale);
+      AZX_LOG_WARN("Stale IDLE on AT%d dropped\r\n", instance);
+    }
+    else if(at_pending.active == ati[instance].running_id && at_pending.instance == instance)
+    {
+      at_pending_complete(ati[instance].running_id, M2MB_RESULT_SUCCESS);
+    }
+    else if(ati[instance].need_resync && !ati[instance].recovering)
+    {
+      /* Late end of an abandoned command: recover here, without blocking */
+      m2mb_ati_rcv_resp(h, g_at_rsp_buf, sizeof(g_at_rsp_buf) - 1);
+      ati[instance].running_id = 0;
+      ati[instance].need_resync = FALSE;
+      AZX_METRICS_INC(at_metrics.resyncs);
+      AZX_LOG_DEBUG("AT%d recovered on its late response\r\n", instance);
+    }
+    else
+    {
+      m2mb_os_sem_put(ati[instance].rsp_sem);
+    }
   }
 }
 
@@ -104,36 +471,70 @@ static void at_cmd_async_callback ( M2MB_ATI_HANDLE h, M2MB_ATI_EVENTS_E ati_eve
 M2MB_RESULT_E at_cmd_async_init(INT16 instance)
 {
   M2MB_OS_SEM_ATTR_HANDLE semAttrHandle;
+  M2MB_OS_EV_ATTR_HANDLE evAttrHandle;
 
-  if (NULL == at_rsp_sem)
+  if (instance < 0 || instance >= AT_INSTANCES)
+  {
+    return M2MB_RESULT_INVALID_ARG;
+  }
+  at_cache_init();
+  if (NULL == arb_lock)
   {
-    m2mb_os_sem_setAttrItem( &semAttrHandle, CMDS_ARGS( M2MB_OS_SEM_SEL_CMD_CREATE_ATTR,  NULL,M2MB_OS_SEM_SEL_CMD_COUNT, 1 /*CS*/, M2MB_OS_SEM_SEL_CMD_TYPE, M2MB_OS_SEM_BINARY,M2MB_OS_SEM_SEL_CMD_NAME, "ATRSPSem"));
-    m2mb_os_sem_init( &at_rsp_sem, &semAttrHandle );
+    m2mb_os_sem_setAttrItem( &semAttrHandle, CMDS_ARGS( M2MB_OS_SEM_SEL_CMD_CREATE_ATTR,  NULL,M2MB_OS_SEM_SEL_CMD_COUNT, 1 /*CS*/, M2MB_OS_SEM_SEL_CMD_TYPE, M2MB_OS_SEM_BINARY,M2MB_OS_SEM_SEL_CMD_NAME, "ATArbLk"));
+    m2mb_os_sem_init( &arb_lock, &semAttrHandle );
+    m2mb_os_ev_setAttrItem( &evAttrHandle, CMDS_ARGS( M2MB_OS_EV_SEL_CMD_CREATE_ATTR, NULL, M2MB_OS_EV_SEL_CMD_NAME, "ATArbEv"));
+    m2mb_os_ev_init( &arb_ev, &evAttrHandle );
   }
+  if (NULL == ati[instance].rsp_sem)
+  {
+    m2mb_os_sem_setAttrItem( &semAttrHandle, CMDS_ARGS( M2MB_OS_SEM_SEL_CMD_CREATE_ATTR,  NULL,M2MB_OS_SEM_SEL_CMD_COUNT, 0, M2MB_OS_SEM_SEL_CMD_TYPE, M2MB_OS_SEM_BINARY,M2MB_OS_SEM_SEL_CMD_NAME, "ATRSPSem"));
+    m2mb_os_sem_init( &ati[instance].rsp_sem, &semAttrHandle );
+  }
+  ati[instance].state = M2MB_STATE_IDLE_EVT;
+
+  at_metrics.sent = azx_metrics_register("at.sent", AZX_METRIC_COUNTER);
+  at_metrics.errors = azx_metrics_register("at.errors", AZX_METRIC_COUNTER);
+  at_metrics.timeouts = azx_metrics_register("at.timeouts", AZX_METRIC_COUNTER);
+  at_metrics.resyncs = azx_metrics_register("at.resyncs", AZX_METRIC_COUNTER);
+  at_metrics.stale = azx_metrics_register("at.stale_idle", AZX_METRIC_COUNTER);
+  at_metrics.rx_bytes = azx_metrics_register("at.rx_bytes", AZX_METRIC_HISTOGRAM);
+  at_metrics.latency_ms = azx_metrics_register("at.latency_ms", AZX_METRIC_HISTOGRAM);
+  at_metrics.urgent_wait_us = azx_metrics_register("at.urgent_wait_us", AZX_METRIC_HISTOGRAM);
 
   AZX_LOG_DEBUG("m2mb_ati_init() on instance %d\r\n", instance);
-  if ( m2mb_ati_init(&ati_handles[instance], instance, at_cmd_async_callback, at_rsp_sem) == M2MB_RESULT_SUCCESS )
+  if ( m2mb_ati_init(&ati[instance].handle, instance, at_cmd_async_callback, (void*)(INT32)instance) == M2MB_RESULT_SUCCESS )
   {
     return M2MB_RESULT_SUCCESS;
   }
   else
   {
+    ati[instance].handle = NULL;
     AZX_LOG_ERROR("m2mb_ati_init() returned failure value\r\n" );
     return M2MB_RESULT_FAIL;
   }
 }
 
+void at_cmd_async_set_urc_cb(at_urc_cb cb)
+{
+  urc_cb = cb;
+}
+
 M2MB_RESULT_E at_cmd_async_deinit(INT16 instance)
 {
-  if (NULL != at_rsp_sem)
+  if (instance < 0 || instance >= AT_INSTANCES)
+  {
+    return M2MB_RESULT_INVALID_ARG;
+  }
+  if (NULL != ati[instance].rsp_sem)
   {
-    m2mb_os_sem_deinit( at_rsp_sem);
-    at_rsp_sem=NULL;
+    m2mb_os_sem_deinit( ati[instance].rsp_sem);
+    ati[instance].rsp_sem=NULL;
   }
 
   AZX_LOG_DEBUG("m2mb_ati_deinit() on instance %d\r\n", instance);
-  if ( m2mb_ati_deinit(ati_handles[instance]) == M2MB_RESULT_SUCCESS )
+  if ( m2mb_ati_deinit(ati[instance].handle) == M2MB_RESULT_SUCCESS )
   {
+    ati[instance].handle = NULL;
     return M2MB_RESULT_SUCCESS;
   }
   else
@@ -144,48 +545,167 @@ M2MB_RESULT_E at_cmd_async_deinit(INT16 instance)
 
 
 M2MB_RESULT_E send_async_at_command(INT16 instance, const CHAR *atCmd, CHAR *atRsp, UINT32 atRspMaxLen)
+{
+  return send_async_at_command_prio(instance, AT_PRIO_INTERACTIVE, atCmd, atRsp, atRspMaxLen);
+}
+
+M2MB_RESULT_E send_async_at_command_prio(INT16 instance, AT_PRIO_E prio, const CHAR *atCmd,
+    CHAR *atRsp, UINT32 atRspMaxLen)
 {
   INT32 cmd_len = 0;
   SSIZE_T rsp_len;
   M2MB_RESULT_E retVal;
-  AZX_LOG_DEBUG("Sending AT Command: %.*s\r\n",strlen(atCmd) -1, atCmd);
-
-  m2mb_os_sem_get(at_rsp_sem, M2MB_OS_WAIT_FOREVER );  //get critical section
+  UINT64 start_us;
+  AT_TMO_CLASS_E cls = at_timeout_class(atCmd);
 
-  memset(g_at_rsp_buf,0, sizeof(g_at_rsp_buf));
+  if(prio == AT_PRIO_URGENT && ati[AT_URGENT_INSTANCE].handle)
+  {
+    instance = AT_URGENT_INSTANCE;  /* never queued behind the other instance */
+  }
+  if(instance < 0 || instance >= AT_INSTANCES || !ati[instance].handle || prio >= AT_PRIO_MAX)
+  {
+    return M2MB_RESULT_INVALID_ARG;
+  }
+  AZX_LOG_DEBUG("Sending AT Command: %.*s\r\n",strlen(atCmd) -1, atCmd);
 
+  AZX_TRACE_BEGIN_EVT("at_cs_wait");
+  at_cs_get(instance, prio, TRUE);  //get critical section
+  AZX_TRACE_END_EVT("at_cs_wait");
+  if(!ati[instance].handle)
+  {
+    /* Lost in a failed recovery */
+    at_cs_put(instance);
+    return M2MB_RESULT_FAIL;
+  }
 
   cmd_len = strlen(atCmd);
 
-  retVal = m2mb_ati_send_cmd(ati_handles[instance], (void*) atCmd, cmd_len);
+  AZX_TRACE_INSTANT_EVT("at_send", cmd_len);
+  AZX_METRICS_INC(at_metrics.sent);
+  start_us = azx_clock_us();
+  ati[instance].running_id = at_new_id();
+  retVal = m2mb_ati_send_cmd(ati[instance].handle, (void*) atCmd, cmd_len);
   if ( retVal != M2MB_RESULT_SUCCESS )
   {
+    AZX_METRICS_INC(at_metrics.errors);
     AZX_LOG_ERROR("m2mb_ati_send_cmd() returned failure value\r\n");
+    ati[instance].running_id = 0;
+    at_cs_put(instance);  /*Release CS*/
     return retVal;
   }
 
   AZX_LOG_DEBUG("waiting command response...\r\n");
   //Wait for AT command response...
-  if( M2MB_OS_SUCCESS != m2mb_os_sem_get(at_rsp_sem, M2MB_OS_MS2TICKS(AT_RSP_TIMEOUT) ) )/* waiting for "IPC" semaphore */
+  AZX_TRACE_BEGIN_EVT("at_rsp_wait");
+  if( M2MB_OS_SUCCESS != m2mb_os_sem_get(ati[instance].rsp_sem, M2MB_OS_MS2TICKS(at_timeout_get(cls)) ) )/* waiting for "IPC" semaphore */
   {
     //failure,
+    AZX_TRACE_END_EVT("at_rsp_wait");
+    AZX_METRICS_INC(at_metrics.timeouts);
     AZX_LOG_ERROR("semaphore timeout!\r\n");
+    at_timeout_expired(cls);
+    at_recover(instance, AT_RESYNC_MS);
+    at_cs_put(instance);  /*Release CS*/
     return M2MB_RESULT_FAIL;
   }
   else
   {
+    AZX_TRACE_END_EVT("at_rsp_wait");
+    ati[instance].running_id = 0;
+    azx_metrics_observe(at_metrics.latency_ms, azx_elapsed_ms(start_us));
+    at_timeout_sample(cls, azx_elapsed_ms(start_us));
     memset(atRsp,0x00,atRspMaxLen);
 
     AZX_LOG_DEBUG("Receive response...\r\n");
-    rsp_len = m2mb_ati_rcv_resp(ati_handles[instance], atRsp, atRspMaxLen);
+    rsp_len = m2mb_ati_rcv_resp(ati[instance].handle, atRsp, atRspMaxLen);
+    AZX_TRACE_INSTANT_EVT("at_rcv", rsp_len);
     if(rsp_len == -1)
     {
-      m2mb_os_sem_put(at_rsp_sem);  /*Release CS*/
+      AZX_METRICS_INC(at_metrics.errors);
+      at_cs_put(instance);  /*Release CS*/
       return M2MB_RESULT_FAIL;
     }
 
-    m2mb_os_sem_put(at_rsp_sem);  /*Release CS*/
+    at_cs_put(instance);  /*Release CS*/
     return M2MB_RESULT_SUCCESS;
   }
 }
 
+M2MB_RESULT_E at_cmd_async_submit(INT16 instance, const CHAR *atCmd, CHAR *atRsp, UINT32 atRspMaxLen,
+    at_done_cb cb, void *arg, UINT32 *id)
+{
+  M2MB_RESULT_E retVal;
+  UINT32 cmd_id;
+
+  if(!cb || !atRsp || atRspMaxLen == 0 || instance < 0 || instance >= AT_INSTANCES ||
+      !ati[instance].handle)
+  {
+    return M2MB_RESULT_INVALID_ARG;
+  }
+  if(at_cs_get(instance, AT_PRIO_INTERACTIVE, FALSE) != M2MB_RESULT_SUCCESS)
+  {
+    /* Another command is in progress */
+    return M2MB_RESULT_SM_UNAVAILABLE;
+  }
+  if(at_pending.active || !ati[instance].handle)
+  {
+    /* One submitted command at a time, whatever the instance */
+    at_cs_put(instance);
+    return ati[instance].handle ? M2MB_RESULT_SM_UNAVAILABLE : M2MB_RESULT_FAIL;
+  }
+  AZX_LOG_DEBUG("Submitting AT Command: %.*s\r\n", strlen(atCmd) - 1, atCmd);
+
+  cmd_id = at_new_id();
+  if(id)
+  {
+    *id = cmd_id;
+  }
+  ati[instance].running_id = cmd_id;
+  at_pending.instance = instance;
+  at_pending.rsp = atRsp;
+  at_pending.rsp_len = atRspMaxLen;
+  at_pending.cb = cb;
+  at_pending.arg = arg;
+  at_pending.start_us = azx_clock_us();
+  at_pending.cls = at_timeout_class(atCmd);
+  __sync_synchronize();
+  at_pending.active = cmd_id;
+  if(!azx_timer_start(&at_pending.deadline, at_timeout_get(at_pending.cls), at_pending_timeout,
+      (void *)(size_t)cmd_id))
+  {
+    /* Not sent without a deadline: it could hold the instance forever */
+    AZX_LOG_ERROR("Cannot arm the command deadline\r\n");
+    if(__sync_bool_compare_and_swap(&at_pending.active, cmd_id, 0))
+    {
+      ati[instance].running_id = 0;
+      at_cs_put(instance);  /*Release CS*/
+    }
+    return M2MB_RESULT_FAIL;
+  }
+
+  AZX_TRACE_INSTANT_EVT("at_send", strlen(atCmd));
+  AZX_METRICS_INC(at_metrics.sent);
+  retVal = m2mb_ati_send_cmd(ati[instance].handle, (void*) atCmd, strlen(atCmd));
+  if(retVal != M2MB_RESULT_SUCCESS)
+  {
+    AZX_METRICS_INC(at_metrics.errors);
+    AZX_LOG_ERROR("m2mb_ati_send_cmd() returned failure value\r\n");
+    if(__sync_bool_compare_and_swap(&at_pending.active, cmd_id, 0))
+    {
+      azx_timer_cancel(&at_pending.deadline);
+      ati[instance].running_id = 0;
+      at_cs_put(instance);  /*Release CS*/
+    }
+  }
+  return retVal;
+}
+
+M2MB_RESULT_E at_cmd_async_cancel(UINT32 id)
+{
+  if(!at_pending_complete(id, M2MB_RESULT_FAIL))
+  {
+    return M2MB_RESULT_FAIL;  /* already completed */
+  }
+  AZX_LOG_DEBUG("Cancelled AT command %u\r\n", id);
+  return M2MB_RESULT_SUCCESS;
+}
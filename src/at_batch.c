@@ -0,0 +1,289 @@
+/**
+  @file
+    at_batch.c
+
+  @brief
+    Batching of AT commands on a single command line
+
+  @details
+    Merged commands are separated by ';' and lose their own "AT" prefix and
+    terminator. Response lines are matched to commands by the command name,
+    the text between "AT" and the first '=', '?' or terminator. Saved round
+    trips are counted in the at.batched metric.
+
+  @version
+    1.0.0
+  @note
+
+
+  @date
+    19/10/2026
+*/
+/* Include files ================================================================================*/
+
+#include <stdio.h>
+#include <string.h>
+#include "m2mb_types.h"
+
+#include "azx_log.h"
+#include "azx_metrics.h"
+
+#include "at_utils.h"
+#include "at_batch.h"
+
+/* Local defines ================================================================================*/
+#define AT_BATCH_NAME_LEN 16
+
+/* Local typedefs ===============================================================================*/
+
+/* Local statics ================================================================================*/
+/* Commands that must have a line of their own, without the AT prefix */
+static const CHAR *standalone[] =
+{
+  "#APLAY",     /* keeps the parser busy while playing */
+  "D",          /* dial, may enter data mode */
+  "O",          /* back to data mode */
+  "A",          /* answer */
+  "Z",          /* reset */
+  "&F",         /* factory profile */
+  "+CMGS",      /* SMS prompt */
+  "+CMGW",
+  "#SSEND",     /* socket prompts */
+  "#SSENDEXT",
+  "#SKTD",
+  "#SD",
+  "#M2MWRITE",  /* file prompts */
+  "#WSCRIPT",
+};
+
+static AZX_METRIC_T *batched;
+
+/* Local function prototypes ====================================================================*/
+static UINT32 cmd_body(const CHAR *cmd, const CHAR **body);
+static UINT32 cmd_name(const CHAR *cmd, CHAR *name, UINT32 name_len);
+static void rsp_append(AT_BATCH_CMD_T *c, const CHAR *line, UINT32 len);
+
+/* Static functions =============================================================================*/
+/* Command without "AT" and the terminator; returns its length */
+static UINT32 cmd_body(const CHAR *cmd, const CHAR **body)
+{
+  UINT32 len;
+
+  if((cmd[0] == 'A' || cmd[0] == 'a') && (cmd[1] == 'T' || cmd[1] == 't'))
+  {
+    cmd += 2;
+  }
+  len = strlen(cmd);
+  while(len > 0 && (cmd[len - 1] == '\r' || cmd[len - 1] == '\n'))
+  {
+    len--;
+  }
+  *body = cmd;
+  return len;
+}
+
+static UINT32 cmd_name(const CHAR *cmd, CHAR *name, UINT32 name_len)
+{
+  const CHAR *body;
+  UINT32 len = cmd_body(cmd, &body);
+  UINT32 n;
+
+  for(n = 0; n < len && n < name_len - 1 && body[n] != '=' && body[n] != '?'; n++)
+  {
+    name[n] = body[n];
+  }
+  name[n] = '\0';
+  return n;
+}
+
+static void rsp_append(AT_BATCH_CMD_T *c, const CHAR *line, UINT32 len)
+{
+  UINT32 used;
+
+  if(!c->rsp || c->rsp_len == 0)
+  {
+    return;
+  }
+  used = strlen(c->rsp);
+  snprintf(c->rsp + used, c->rsp_len - used, "\r\n%.*s\r\n", (int)len, line);
+}
+
+/* Global functions =============================================================================*/
+BOOLEAN at_batch_chainable(const CHAR *cmd)
+{
+  const CHAR *body;
+  UINT32 len = cmd_body(cmd, &body);
+  UINT32 i, n;
+
+  if(len == 0 || memchr(body, ';', len))
+  {
+    return FALSE;
+  }
+  for(i = 0; i < sizeof(standalone) / sizeof(standalone[0]); i++)
+  {
+    n = strlen(standalone[i]);
+    if(len >= n && strncasecmp(body, standalone[i], n) == 0)
+    {
+      return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+UINT32 at_batch_compile(const AT_BATCH_CMD_T *cmds, UINT32 count, CHAR *line, UINT32 line_len)
+{
+  const CHAR *body;
+  UINT32 i, len, used;
+
+  if(count == 0 || line_len < 4)
+  {
+    return 0;
+  }
+  len = cmd_body(cmds[0].cmd, &body);
+  if(len + 4 > line_len)  /* "AT" + body + "\r" + terminator */
+  {
+    return 0;
+  }
+  used = snprintf(line, line_len, "AT%.*s", (int)len, body);
+  i = 1;
+  if(at_batch_chainable(cmds[0].cmd))
+  {
+    for(; i < count && at_batch_chainable(cmds[i].cmd); i++)
+    {
+      len = cmd_body(cmds[i].cmd, &body);
+      if(used + 1 + len + 2 > line_len)
+      {
+        break;
+      }
+      used += snprintf(line + used, line_len - used, ";%.*s", (int)len, body);
+    }
+  }
+  snprintf(line + used, line_len - used, "\r");
+  return i;
+}
+
+void at_batch_split(const CHAR *rsp, AT_BATCH_CMD_T *cmds, UINT32 count)
+{
+  CHAR name[AT_BATCH_NAME_LEN];
+  const CHAR *p = rsp;
+  const CHAR *end;
+  BOOLEAN ok = FALSE;
+  UINT32 i, j, len, n;
+  UINT32 cur = 0;
+
+  for(i = 0; i < count; i++)
+  {
+    if(cmds[i].rsp && cmds[i].rsp_len > 0)
+    {
+      cmds[i].rsp[0] = '\0';
+    }
+  }
+
+  while(*p)
+  {
+    end = strpbrk(p, "\r\n");
+    len = end ? (UINT32)(end - p) : strlen(p);
+    if(len == 0)
+    {
+      p++;
+      continue;
+    }
+
+    if(len == 2 && strncmp(p, "OK", 2) == 0)
+    {
+      ok = TRUE;
+    }
+    else if(len >= 2 && strncasecmp(p, "AT", 2) == 0)
+    {
+      /* echo of the command line */
+    }
+    else if(strncmp(p, "ERROR", 5) == 0 || strncmp(p, "+CME ERROR", 10) == 0)
+    {
+      ok = FALSE;
+    }
+    else
+    {
+      for(j = cur; j < count; j++)
+      {
+        n = cmd_name(cmds[j].cmd, name, sizeof(name));
+        if(n > 0 && len > n && strncmp(p, name, n) == 0 && p[n] == ':')
+        {
+          cur = j;
+          break;
+        }
+      }
+      rsp_append(&cmds[cur], p, len);
+    }
+    p += len;
+  }
+
+  for(i = 0; i < count; i++)
+  {
+    cmds[i].ok = ok;
+    rsp_append(&cmds[i], ok ? "OK" : "ERROR", ok ? 2 : 5);
+  }
+}
+
+M2MB_RESULT_E at_batch_send(INT16 instance, AT_BATCH_CMD_T *cmds, UINT32 count)
+{
+  CHAR line[AT_BATCH_LINE_MAX];
+  CHAR rsp[AT_BATCH_RSP_LEN];
+  M2MB_RESULT_E result = M2MB_RESULT_SUCCESS;
+  UINT32 i, j, n;
+
+  if(!batched)
+  {
+    batched = azx_metrics_register("at.batched", AZX_METRIC_COUNTER);
+  }
+
+  for(i = 0; i < count; i += n)
+  {
+    n = at_batch_compile(&cmds[i], count - i, line, sizeof(line));
+    if(n == 0)
+    {
+      AZX_LOG_ERROR("Command too long: %s\r\n", cmds[i].cmd);
+      cmds[i].ok = FALSE;
+      result = M2MB_RESULT_FAIL;
+      n = 1;
+      continue;
+    }
+
+    if(send_async_at_command(instance, line, rsp, sizeof(rsp)) == M2MB_RESULT_SUCCESS)
+    {
+      at_batch_split(rsp, &cmds[i], n);
+    }
+    else
+    {
+      cmds[i].ok = FALSE;
+    }
+
+    if(n > 1 && !cmds[i].ok)
+    {
+      /* The modem does not tell which command failed: find it out */
+      AZX_LOG_WARN("Batch <%.*s> failed, sending its commands one by one\r\n",
+          strlen(line) - 1, line);
+      for(j = i; j < i + n; j++)
+      {
+        cmds[j].ok = send_async_at_command(instance, cmds[j].cmd, rsp, sizeof(rsp)) ==
+            M2MB_RESULT_SUCCESS && strstr(rsp, "OK") != NULL;
+        if(cmds[j].rsp && cmds[j].rsp_len > 0)
+        {
+          snprintf(cmds[j].rsp, cmds[j].rsp_len, "%s", rsp);
+        }
+      }
+    }
+    else if(n > 1)
+    {
+      azx_metrics_add(batched, n - 1);
+    }
+
+    for(j = i; j < i + n; j++)
+    {
+      if(!cmds[j].ok)
+      {
+        result = M2MB_RESULT_FAIL;
+      }
+    }
+  }
+  return result;
+}
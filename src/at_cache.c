@@ -0,0 +1,239 @@
+/**
+  @file
+    at_cache.c
+
+  @brief
+    Response cache for AT queries returning static or slowly changing data
+
+  @details
+    The cache is a small table of entries keyed by the command string, with
+    the oldest entry replaced when it is full. Invalidations only set bits in
+    a pending mask and bump a generation counter, so they never block; the
+    pending bits are applied at the next lookup. A response fetched while an
+    invalidation happened is not stored, as it may already be stale.
+
+  @version
+    1.0.0
+  @note
+
+
+  @date
+    19/10/2026
+*/
+/* Include files ================================================================================*/
+
+#include <stdio.h>
+#include <string.h>
+#include "m2mb_types.h"
+#include "m2mb_os_api.h"
+
+#include "azx_log.h"
+#include "azx_utils.h"
+#include "azx_metrics.h"
+
+#include "at_utils.h"
+#include "at_cache.h"
+
+/* Local defines ================================================================================*/
+#define AT_CACHE_ENTRIES 8
+#define AT_CACHE_CMD_LEN 16
+#define AT_CACHE_RSP_LEN 100
+
+/* Local typedefs ===============================================================================*/
+typedef struct
+{
+  const CHAR *cmd;   /* without the terminator */
+  UINT32 ttl_ms;
+  UINT32 events;     /* AT_CACHE_EV_* dropping the response */
+} AT_CACHE_POLICY_T;
+
+typedef struct
+{
+  const AT_CACHE_POLICY_T *policy;  /* NULL if the entry is free */
+  UINT64 stored_us;
+  CHAR rsp[AT_CACHE_RSP_LEN];
+} AT_CACHE_ENTRY_T;
+
+/* Local statics ================================================================================*/
+static const AT_CACHE_POLICY_T policies[] =
+{
+  { "AT+CGSN",   AT_CACHE_FOREVER, 0 },
+  { "AT+GSN",    AT_CACHE_FOREVER, 0 },
+  { "AT+CGMI",   AT_CACHE_FOREVER, 0 },
+  { "AT+CGMM",   AT_CACHE_FOREVER, 0 },
+  { "AT#CGMM",   AT_CACHE_FOREVER, 0 },
+  { "AT+CGMR",   AT_CACHE_FOREVER, 0 },
+  { "AT#CGMR",   AT_CACHE_FOREVER, 0 },
+  { "AT#SWPKGV", AT_CACHE_FOREVER, 0 },
+  { "AT+CIMI",   AT_CACHE_FOREVER, AT_CACHE_EV_SIM },
+  { "AT#CCID",   AT_CACHE_FOREVER, AT_CACHE_EV_SIM },
+  { "AT+CCID",   AT_CACHE_FOREVER, AT_CACHE_EV_SIM },
+  { "AT+ICCID",  AT_CACHE_FOREVER, AT_CACHE_EV_SIM },
+  { "AT+CNUM",   AT_CACHE_FOREVER, AT_CACHE_EV_SIM },
+  { "AT+COPS?",  30000,            AT_CACHE_EV_SIM | AT_CACHE_EV_NETWORK },
+};
+
+/* URC prefixes and the events they signal */
+static const struct
+{
+  const CHAR *prefix;
+  UINT32 events;
+} urc_events[] =
+{
+  { "#QSS:",   AT_CACHE_EV_SIM },
+  { "+CREG:",  AT_CACHE_EV_NETWORK },
+  { "+CGREG:", AT_CACHE_EV_NETWORK },
+  { "+CEREG:", AT_CACHE_EV_NETWORK },
+};
+
+static AT_CACHE_ENTRY_T entries[AT_CACHE_ENTRIES];
+static M2MB_OS_SEM_HANDLE cache_sem = NULL;
+static volatile UINT32 pending_events = 0;
+static volatile UINT32 generation = 0;
+
+static struct
+{
+  AZX_METRIC_T *hits;
+  AZX_METRIC_T *misses;
+} cache_metrics;
+
+/* Local function prototypes ====================================================================*/
+static const AT_CACHE_POLICY_T *policy_of(const CHAR *cmd);
+static AT_CACHE_ENTRY_T *lookup(const AT_CACHE_POLICY_T *policy);
+
+/* Static functions =============================================================================*/
+static const AT_CACHE_POLICY_T *policy_of(const CHAR *cmd)
+{
+  UINT32 i, len = strlen(cmd);
+
+  while(len > 0 && (cmd[len - 1] == '\r' || cmd[len - 1] == '\n'))
+  {
+    len--;
+  }
+  for(i = 0; i < sizeof(policies) / sizeof(policies[0]); i++)
+  {
+    if(strlen(policies[i].cmd) == len && strncasecmp(policies[i].cmd, cmd, len) == 0)
+    {
+      return &policies[i];
+    }
+  }
+  return NULL;
+}
+
+/* Applies the pending invalidations, then finds the entry of policy; called locked */
+static AT_CACHE_ENTRY_T *lookup(const AT_CACHE_POLICY_T *policy)
+{
+  UINT32 events = __sync_fetch_and_and(&pending_events, 0);
+  AT_CACHE_ENTRY_T *found = NULL;
+  UINT32 i;
+
+  for(i = 0; i < AT_CACHE_ENTRIES; i++)
+  {
+    AT_CACHE_ENTRY_T *e = &entries[i];
+
+    if(e->policy && (e->policy->events & events))
+    {
+      e->policy = NULL;
+    }
+    if(e->policy && e->policy->ttl_ms != AT_CACHE_FOREVER &&
+        AZX_CLOCK_EXPIRED(e->stored_us, (UINT64)e->policy->ttl_ms * 1000))
+    {
+      e->policy = NULL;
+    }
+    if(e->policy == policy)
+    {
+      found = e;
+    }
+  }
+  return found;
+}
+
+/* Global functions =============================================================================*/
+void at_cache_init(void)
+{
+  M2MB_OS_SEM_ATTR_HANDLE semAttrHandle;
+
+  if(NULL == cache_sem)
+  {
+    m2mb_os_sem_setAttrItem(&semAttrHandle, CMDS_ARGS(M2MB_OS_SEM_SEL_CMD_CREATE_ATTR, NULL,
+        M2MB_OS_SEM_SEL_CMD_COUNT, 1 /*CS*/, M2MB_OS_SEM_SEL_CMD_TYPE, M2MB_OS_SEM_BINARY,
+        M2MB_OS_SEM_SEL_CMD_NAME, "ATCacheLk"));
+    m2mb_os_sem_init(&cache_sem, &semAttrHandle);
+  }
+}
+
+M2MB_RESULT_E at_cache_send(INT16 instance, const CHAR *atCmd, CHAR *atRsp, UINT32 atRspMaxLen)
+{
+  const AT_CACHE_POLICY_T *policy = policy_of(atCmd);
+  AT_CACHE_ENTRY_T *e;
+  M2MB_RESULT_E result;
+  UINT32 gen, i;
+
+  if(!policy || !cache_sem)
+  {
+    return send_async_at_command(instance, atCmd, atRsp, atRspMaxLen);
+  }
+  if(!cache_metrics.hits)
+  {
+    cache_metrics.hits = azx_metrics_register("at.cache_hits", AZX_METRIC_COUNTER);
+    cache_metrics.misses = azx_metrics_register("at.cache_misses", AZX_METRIC_COUNTER);
+  }
+
+  m2mb_os_sem_get(cache_sem, M2MB_OS_WAIT_FOREVER);
+  e = lookup(policy);
+  if(e)
+  {
+    snprintf(atRsp, atRspMaxLen, "%s", e->rsp);
+    m2mb_os_sem_put(cache_sem);
+    AZX_METRICS_INC(cache_metrics.hits);
+    AZX_LOG_DEBUG("Cache hit: %s\r\n", policy->cmd);
+    return M2MB_RESULT_SUCCESS;
+  }
+  m2mb_os_sem_put(cache_sem);
+  AZX_METRICS_INC(cache_metrics.misses);
+
+  gen = generation;
+  result = send_async_at_command(instance, atCmd, atRsp, atRspMaxLen);
+  if(result != M2MB_RESULT_SUCCESS || !strstr(atRsp, "OK") || strlen(atRsp) >= AT_CACHE_RSP_LEN)
+  {
+    return result;
+  }
+
+  m2mb_os_sem_get(cache_sem, M2MB_OS_WAIT_FOREVER);
+  if(gen == generation && !lookup(policy))
+  {
+    /* A free entry, or else the oldest one */
+    e = &entries[0];
+    for(i = 0; i < AT_CACHE_ENTRIES && e->policy; i++)
+    {
+      if(!entries[i].policy || entries[i].stored_us < e->stored_us)
+      {
+        e = &entries[i];
+      }
+    }
+    snprintf(e->rsp, sizeof(e->rsp), "%s", atRsp);
+    e->stored_us = azx_clock_us();
+    e->policy = policy;
+  }
+  m2mb_os_sem_put(cache_sem);
+  return result;
+}
+
+void at_cache_invalidate(UINT32 events)
+{
+  __sync_fetch_and_or(&pending_events, events);
+  __sync_fetch_and_add(&generation, 1);
+}
+
+void at_cache_urc(const CHAR *urc)
+{
+  UINT32 i;
+
+  for(i = 0; i < sizeof(urc_events) / sizeof(urc_events[0]); i++)
+  {
+    if(strstr(urc, urc_events[i].prefix))
+    {
+      at_cache_invalidate(urc_events[i].events);
+    }
+  }
+}
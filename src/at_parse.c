@@ -0,0 +1,255 @@
+/**
+  @file
+    at_parse.c
+
+  @brief
+    Typed decoders for AT response lines
+
+  @details
+    A line is found by comparing its start with the prefix, then its fields
+    are walked once, each stored at its offset in the output struct.
+    Integers longer than AT_PARSE_INT_DIGITS digits are malformed, which
+    keeps the conversion free of overflow.
+
+  @version
+    1.0.0
+  @note
+
+
+  @date
+    19/10/2026
+*/
+/* Include files ================================================================================*/
+
+#include <stddef.h>
+#include <string.h>
+#include "m2mb_types.h"
+
+#include "at_parse.h"
+
+/* Local defines ================================================================================*/
+#define AT_PARSE_INT_DIGITS 9
+#define AT_PARSE_COUNT(f) (sizeof(f) / sizeof((f)[0]))
+
+/* Local typedefs ===============================================================================*/
+
+/* Local statics ================================================================================*/
+static const AT_PARSE_FIELD_T csq_fields[] =
+{
+  { AT_PARSE_INT, offsetof(AT_CSQ_T, rssi) },
+  { AT_PARSE_INT, offsetof(AT_CSQ_T, ber) },
+};
+
+static const AT_PARSE_FIELD_T gpio_fields[] =
+{
+  { AT_PARSE_INT, offsetof(AT_GPIO_T, dir) },
+  { AT_PARSE_INT, offsetof(AT_GPIO_T, stat) },
+};
+
+static const AT_PARSE_FIELD_T aplay_fields[] =
+{
+  { AT_PARSE_INT, offsetof(AT_APLAY_T, status) },
+  { AT_PARSE_STR, offsetof(AT_APLAY_T, file) },
+};
+
+static const AT_PARSE_FIELD_T creg_fields[] =
+{
+  { AT_PARSE_INT, offsetof(AT_CREG_T, n) },
+  { AT_PARSE_INT, offsetof(AT_CREG_T, stat) },
+  { AT_PARSE_STR, offsetof(AT_CREG_T, lac) },
+  { AT_PARSE_STR, offsetof(AT_CREG_T, ci) },
+  { AT_PARSE_INT, offsetof(AT_CREG_T, act) },
+};
+
+/* Same line without <n>, as sent in the URC */
+static const AT_PARSE_FIELD_T creg_urc_fields[] =
+{
+  { AT_PARSE_INT, offsetof(AT_CREG_T, stat) },
+  { AT_PARSE_STR, offsetof(AT_CREG_T, lac) },
+  { AT_PARSE_STR, offsetof(AT_CREG_T, ci) },
+  { AT_PARSE_INT, offsetof(AT_CREG_T, act) },
+};
+
+/* Local function prototypes ====================================================================*/
+static const CHAR *find_line(const CHAR *rsp, const CHAR *prefix);
+static const CHAR *parse_int(const CHAR *p, INT32 *v);
+static const CHAR *parse_str(const CHAR *p, AT_PARSE_STR_T *s);
+
+/* Static functions =============================================================================*/
+/* Start of the first field of the line beginning with prefix, NULL if there is none */
+static const CHAR *find_line(const CHAR *rsp, const CHAR *prefix)
+{
+  UINT32 n = strlen(prefix);
+  const CHAR *p = rsp;
+
+  while(*p)
+  {
+    if(strncmp(p, prefix, n) == 0)
+    {
+      p += n;
+      while(*p == ' ')
+      {
+        p++;
+      }
+      return p;
+    }
+    while(*p && *p != '\n')
+    {
+      p++;
+    }
+    if(*p)
+    {
+      p++;
+    }
+    while(*p == '\r' || *p == '\n')
+    {
+      p++;
+    }
+  }
+  return NULL;
+}
+
+static const CHAR *parse_int(const CHAR *p, INT32 *v)
+{
+  BOOLEAN neg = (*p == '-');
+  INT32 n = 0;
+  UINT32 digits = 0;
+
+  if(*p == '-' || *p == '+')
+  {
+    p++;
+  }
+  while(*p >= '0' && *p <= '9')
+  {
+    if(++digits > AT_PARSE_INT_DIGITS)
+    {
+      return NULL;
+    }
+    n = n * 10 + (*p++ - '0');
+  }
+  if(digits == 0)
+  {
+    return NULL;
+  }
+  *v = neg ? -n : n;
+  return p;
+}
+
+static const CHAR *parse_str(const CHAR *p, AT_PARSE_STR_T *s)
+{
+  const CHAR *start;
+
+  if(*p == '"')
+  {
+    start = ++p;
+    while(*p && *p != '"' && *p != '\r' && *p != '\n')
+    {
+      p++;
+    }
+    if(*p != '"')
+    {
+      return NULL;
+    }
+    s->p = start;
+    s->len = (UINT16)(p - start);
+    return p + 1;
+  }
+  start = p;
+  while(*p && *p != ',' && *p != '\r' && *p != '\n')
+  {
+    p++;
+  }
+  s->p = start;
+  s->len = (UINT16)(p - start);
+  return p;
+}
+
+/* Global functions =============================================================================*/
+INT32 at_parse_line(const CHAR *rsp, const CHAR *prefix, const AT_PARSE_FIELD_T *fields,
+    UINT32 count, void *out)
+{
+  const CHAR *p;
+  AT_PARSE_STR_T skip;
+  UINT32 i;
+
+  if(!rsp || !prefix || (p = find_line(rsp, prefix)) == NULL)
+  {
+    return -1;
+  }
+  for(i = 0; i < count; i++)
+  {
+    if(*p == '\0' || *p == '\r' || *p == '\n')
+    {
+      break;  /* optional trailing fields missing */
+    }
+    switch(fields[i].type)
+    {
+    case AT_PARSE_INT:
+      p = parse_int(p, (INT32 *)((UINT8 *)out + fields[i].offset));
+      break;
+    case AT_PARSE_STR:
+      p = parse_str(p, (AT_PARSE_STR_T *)((UINT8 *)out + fields[i].offset));
+      break;
+    default:
+      p = parse_str(p, &skip);
+      break;
+    }
+    if(!p)
+    {
+      return -1;
+    }
+    if(*p == ',')
+    {
+      p++;
+    }
+    else if(*p != '\0' && *p != '\r' && *p != '\n')
+    {
+      return -1;
+    }
+  }
+  return (INT32)i;
+}
+
+BOOLEAN at_parse_csq(const CHAR *rsp, AT_CSQ_T *out)
+{
+  out->rssi = AT_PARSE_NONE;
+  out->ber = AT_PARSE_NONE;
+  return at_parse_line(rsp, "+CSQ:", csq_fields, AT_PARSE_COUNT(csq_fields), out) == 2;
+}
+
+BOOLEAN at_parse_gpio(const CHAR *rsp, AT_GPIO_T *out)
+{
+  out->dir = AT_PARSE_NONE;
+  out->stat = AT_PARSE_NONE;
+  return at_parse_line(rsp, "#GPIO:", gpio_fields, AT_PARSE_COUNT(gpio_fields), out) == 2;
+}
+
+BOOLEAN at_parse_aplay(const CHAR *rsp, AT_APLAY_T *out)
+{
+  out->status = AT_PARSE_NONE;
+  out->file.p = NULL;
+  out->file.len = 0;
+  return at_parse_line(rsp, "#APLAY:", aplay_fields, AT_PARSE_COUNT(aplay_fields), out) >= 1;
+}
+
+BOOLEAN at_parse_creg(const CHAR *rsp, AT_CREG_T *out)
+{
+  AT_CREG_T urc;
+  INT32 n;
+
+  memset(out, 0, sizeof(*out));
+  out->n = AT_PARSE_NONE;
+  out->stat = AT_PARSE_NONE;
+  out->act = AT_PARSE_NONE;
+  urc = *out;
+
+  /* A quoted second field or a single field means the URC form, without <n> */
+  n = at_parse_line(rsp, "+CREG:", creg_fields, AT_PARSE_COUNT(creg_fields), out);
+  if(n >= 2)
+  {
+    return TRUE;
+  }
+  n = at_parse_line(rsp, "+CREG:", creg_urc_fields, AT_PARSE_COUNT(creg_urc_fields), &urc);
+  *out = urc;
+  return n >= 1;
+}
@@ -0,0 +1,194 @@
+/**
+  @file
+    at_timeout.c
+
+  @brief
+    Response timeouts of the AT commands, learnt from their latency
+
+  @details
+    The estimator is the one of RFC 6298: srtt += err / 8, rttvar +=
+    (|err| - rttvar) / 4, rto = srtt + 4 * rttvar, in ms. Only commands
+    answered in time feed it, so a late response cannot shrink the timeout.
+    Concurrent updates of one class may lose a sample, which is harmless.
+
+  @version
+    1.0.0
+  @note
+
+
+  @date
+    19/10/2026
+*/
+/* Include files ================================================================================*/
+
+#include <string.h>
+#include "m2mb_types.h"
+
+#include "azx_log.h"
+#include "azx_metrics.h"
+
+#include "at_timeout.h"
+
+/* Local defines ================================================================================*/
+
+/* Local typedefs ===============================================================================*/
+typedef struct
+{
+  const CHAR *name;
+  UINT32 initial_ms;
+  UINT32 min_ms;
+  UINT32 max_ms;
+  const CHAR *metric;
+  BOOLEAN sampled;
+  INT32 srtt_ms;
+  INT32 rttvar_ms;
+  UINT32 rto_ms;
+  AZX_METRIC_T *gauge;
+} AT_TMO_T;
+
+/* Local statics ================================================================================*/
+static AT_TMO_T classes[AT_TMO_MAX] =
+{
+  { "quick",   5000,   1000,  30000,  "at.rto_quick_ms",   FALSE, 0, 0, 5000,   NULL },
+  { "audio",   10000,  2000,  60000,  "at.rto_audio_ms",   FALSE, 0, 0, 10000,  NULL },
+  { "network", 120000, 10000, 180000, "at.rto_network_ms", FALSE, 0, 0, 120000, NULL },
+  { "default", 60000,  5000,  120000, "at.rto_default_ms", FALSE, 0, 0, 60000,  NULL },
+};
+
+/* Command prefixes, without "AT", and their class; first match wins */
+static const struct
+{
+  const CHAR *prefix;
+  AT_TMO_CLASS_E cls;
+} class_of[] =
+{
+  { "#APLAY?", AT_TMO_QUICK },
+  { "#APLAY",  AT_TMO_AUDIO },
+  { "E",       AT_TMO_QUICK },
+  { "#VAUX",   AT_TMO_QUICK },
+  { "#DVI",    AT_TMO_QUICK },
+  { "#GPIO",   AT_TMO_QUICK },
+  { "$GPSP",   AT_TMO_QUICK },
+  { "$GPSSAV", AT_TMO_DEFAULT },  /* NVM write */
+  { "+CMEE",   AT_TMO_QUICK },
+  { "+CSQ",    AT_TMO_QUICK },
+  { "+CGSN",   AT_TMO_QUICK },
+  { "+CGMR",   AT_TMO_QUICK },
+  { "#CGMM",   AT_TMO_QUICK },
+  { "+COPS",   AT_TMO_NETWORK },
+  { "+CGATT",  AT_TMO_NETWORK },
+  { "+CGACT",  AT_TMO_NETWORK },
+  { "#SGACT",  AT_TMO_NETWORK },
+  { "#SD",     AT_TMO_NETWORK },
+};
+
+/* Local function prototypes ====================================================================*/
+static AT_TMO_CLASS_E class_of_one(const CHAR *cmd);
+static void rto_update(AT_TMO_T *t, UINT32 rto_ms);
+
+/* Static functions =============================================================================*/
+/* Class of the command at the start of cmd, without "AT" */
+static AT_TMO_CLASS_E class_of_one(const CHAR *cmd)
+{
+  UINT32 i;
+
+  for(i = 0; i < sizeof(class_of) / sizeof(class_of[0]); i++)
+  {
+    if(strncasecmp(cmd, class_of[i].prefix, strlen(class_of[i].prefix)) == 0)
+    {
+      return class_of[i].cls;
+    }
+  }
+  return AT_TMO_DEFAULT;
+}
+
+static void rto_update(AT_TMO_T *t, UINT32 rto_ms)
+{
+  if(rto_ms < t->min_ms)
+  {
+    rto_ms = t->min_ms;
+  }
+  if(rto_ms > t->max_ms)
+  {
+    rto_ms = t->max_ms;
+  }
+  t->rto_ms = rto_ms;
+  if(!t->gauge)
+  {
+    t->gauge = azx_metrics_register(t->metric, AZX_METRIC_GAUGE);
+  }
+  azx_metrics_set(t->gauge, rto_ms);
+}
+
+/* Global functions =============================================================================*/
+AT_TMO_CLASS_E at_timeout_class(const CHAR *cmd)
+{
+  AT_TMO_CLASS_E cls, slowest;
+  BOOLEAN quoted = FALSE;
+
+  if(strncasecmp(cmd, "AT", 2) == 0)
+  {
+    cmd += 2;
+  }
+  slowest = class_of_one(cmd);
+  /* A chained line takes as long as its slowest command: the longest upper bound */
+  for(; *cmd; cmd++)
+  {
+    if(*cmd == '"')
+    {
+      quoted = !quoted;
+    }
+    else if(*cmd == ';' && !quoted)
+    {
+      cls = class_of_one(cmd + 1);
+      if(classes[cls].max_ms > classes[slowest].max_ms)
+      {
+        slowest = cls;
+      }
+    }
+  }
+  return slowest;
+}
+
+UINT32 at_timeout_get(AT_TMO_CLASS_E cls)
+{
+  return classes[(cls < AT_TMO_MAX) ? cls : AT_TMO_DEFAULT].rto_ms;
+}
+
+void at_timeout_sample(AT_TMO_CLASS_E cls, UINT32 latency_ms)
+{
+  AT_TMO_T *t;
+  INT32 err;
+
+  if(cls >= AT_TMO_MAX)
+  {
+    return;
+  }
+  t = &classes[cls];
+  if(!t->sampled)
+  {
+    t->srtt_ms = (INT32)latency_ms;
+    t->rttvar_ms = (INT32)latency_ms / 2;
+    t->sampled = TRUE;
+  }
+  else
+  {
+    err = (INT32)latency_ms - t->srtt_ms;
+    t->srtt_ms += err / 8;
+    t->rttvar_ms += ((err < 0 ? -err : err) - t->rttvar_ms) / 4;
+  }
+  rto_update(t, (UINT32)(t->srtt_ms + 4 * t->rttvar_ms));
+}
+
+void at_timeout_expired(AT_TMO_CLASS_E cls)
+{
+  AT_TMO_T *t;
+
+  if(cls >= AT_TMO_MAX)
+  {
+    return;
+  }
+  t = &classes[cls];
+  rto_update(t, t->rto_ms * 2);
+  AZX_LOG_WARN("AT %s timeout, now %u ms\r\n", t->name, t->rto_ms);
+}
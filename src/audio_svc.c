@@ -0,0 +1,555 @@
+/**
+  @file
+    audio_svc.c
+
+  @brief
+    Persistent audio service task
+
+  @details
+    Requests are received through an m2mb_os_q message queue and served in
+    order by a single task, which owns the codec session for its lifetime.
+
+  @version
+    1.0.0
+  @note
+
+
+  @date
+    19/10/2026
+*/
+/* Include files ================================================================================*/
+
+#include <stdio.h>
+#include <string.h>
+#include "m2mb_types.h"
+#include "m2mb_os_api.h"
+
+#include "azx_log.h"
+#include "azx_trace.h"
+#include "azx_metrics.h"
+#include "azx_utils.h"
+#include "azx_timer.h"
+
+#include "app_cfg.h"
+#include "at_utils.h"
+#include "at_parse.h"
+#include "boot_prof.h"
+#include "codec.h"
+#include "codec_pwr.h"
+#include "codec_ramp.h"
+#include "modem_state.h"
+#include "i2c_bus.h"
+#include "playlist.h"
+#include "audio_svc.h"
+
+/* Local defines ================================================================================*/
+#define AUDIO_SVC_STACK_SIZE 8192
+#define AUDIO_SVC_PRIORITY   200
+
+/* AT#DVI parameters: DVI enabled on port 2, modem as master */
+#define AUDIO_SVC_DVI_CFG    "1,2,1"
+
+/* Status polling period while a clip plays, in case the end URC is missed */
+#define AUDIO_SVC_POLL_MS    200
+
+/* Internal request posted when the end of playback is detected */
+#define AUDIO_SVC_DONE       0x100
+
+/* Internal request posted by the verify timer */
+#define AUDIO_SVC_VERIFY     0x101
+
+/* Internal request posted by the idle timer */
+#define AUDIO_SVC_IDLE       0x102
+
+/* Local typedefs ===============================================================================*/
+typedef struct
+{
+  UINT32 cmd;
+  UINT32 arg;
+  CHAR file[AUDIO_SVC_FILE_LEN];
+} AUDIO_SVC_MSG_T;
+
+/* Local statics ================================================================================*/
+static M2MB_OS_TASK_HANDLE svc_task = NULL;
+static M2MB_OS_Q_HANDLE svc_q = NULL;
+static UINT32 svc_q_area[AUDIO_SVC_QUEUE_LEN * WORD32_FOR_MSG(AUDIO_SVC_MSG_T)];
+
+static INT16 svc_instance;
+static BOOLEAN codec_ready = FALSE;
+static BOOLEAN first_play = TRUE;
+static BOOLEAN playing = FALSE;
+static BOOLEAN skip_done = FALSE;  /* next end URC comes from our own stop */
+static volatile UINT32 stops = 0;  /* audio_svc_stop() calls not served yet: start nothing */
+static UINT64 done_us;
+static AZX_METRIC_T *gap_ms;
+static AZX_METRIC_T *trigger_ms;
+static BOOLEAN trigger_pending = FALSE;
+static UINT32 trigger_edge_ms;
+static CHAR rsp[100];
+static AZX_TIMER_T verify_tmr;
+static AZX_TIMER_T idle_tmr;
+static BOOLEAN idle_armed = FALSE;
+
+/* Local function prototypes ====================================================================*/
+static BOOLEAN send_at(const CHAR *cmd);
+static BOOLEAN send_at_prio(AT_PRIO_E prio, const CHAR *cmd);
+static BOOLEAN audio_svc_bringup(void);
+static BOOLEAN audio_svc_aplay(const CHAR *file);
+static void audio_svc_play_next(void);
+static BOOLEAN audio_svc_poll_done(void);
+static void audio_svc_urc(const CHAR *urc);
+static void audio_svc_tmr_cb(void *arg);
+static void audio_svc_idle_update(void);
+static BOOLEAN audio_svc_wake(void);
+static void audio_svc_serve(const AUDIO_SVC_MSG_T *msg);
+static void audio_svc_task(void *arg);
+static M2MB_RESULT_E audio_svc_post(UINT32 cmd, UINT32 arg, const CHAR *file);
+
+/* Static functions =============================================================================*/
+static BOOLEAN send_at(const CHAR *cmd)
+{
+  return send_at_prio(AT_PRIO_INTERACTIVE, cmd);
+}
+
+static BOOLEAN send_at_prio(AT_PRIO_E prio, const CHAR *cmd)
+{
+  if(send_async_at_command_prio(svc_instance, prio, cmd, rsp, sizeof(rsp)) != M2MB_RESULT_SUCCESS)
+  {
+    AZX_LOG_ERROR("Error sending command <%s>\r\n", cmd);
+    return FALSE;
+  }
+  AZX_LOG_INFO("Command response: <%s>\r\n\r\n", rsp);
+  return TRUE;
+}
+
+/*-----------------------------------------------------------------------------------------------*/
+/*!
+  \brief Powers up the codec and applies the DVI and register configuration
+
+  \return TRUE if the codec is ready to play
+ */
+/*-----------------------------------------------------------------------------------------------*/
+static BOOLEAN audio_svc_bringup(void)
+{
+  BOOLEAN ok = TRUE;
+
+  boot_prof_begin(BOOT_PROF_VAUX);
+  ok &= codec_pwr_vaux_on(svc_instance);
+  boot_prof_end(BOOT_PROF_VAUX);
+  boot_prof_begin(BOOT_PROF_GPIO);
+  ok &= codec_pwr_enable();
+  boot_prof_end(BOOT_PROF_GPIO);
+  /* AT#DVI must always be sent after power-on, even if the modem is already configured:
+   * the state model never skips it */
+  boot_prof_begin(BOOT_PROF_DVI);
+  ok &= modem_state_set(svc_instance, MODEM_STATE_DVI, AUDIO_SVC_DVI_CFG, NULL);
+  boot_prof_end(BOOT_PROF_DVI);
+  boot_prof_begin(BOOT_PROF_CODEC_I2C);
+  ok &= codec_write_hex(CODEC_DEFAULT_CFG);
+  boot_prof_end(BOOT_PROF_CODEC_I2C);
+#if CODEC_I2C_BENCH > 0
+  codec_bench(CODEC_I2C_BENCH);
+#endif
+  boot_prof_begin(BOOT_PROF_ATE0_LOOP);
+  modem_state_set(svc_instance, MODEM_STATE_ECHO, "0", NULL);
+  boot_prof_end(BOOT_PROF_ATE0_LOOP);
+  return ok;
+}
+
+static BOOLEAN audio_svc_aplay(const CHAR *file)
+{
+  CHAR cmd[AUDIO_SVC_FILE_LEN + 20];
+  BOOLEAN ok;
+
+  if(stops)
+  {
+    return FALSE;
+  }
+  snprintf(cmd, sizeof(cmd), "AT#APLAY=1,0,\"%s\"\r", file);
+  if(first_play)
+  {
+    boot_prof_begin(BOOT_PROF_APLAY);
+  }
+  if(trigger_pending)
+  {
+    azx_metrics_observe(trigger_ms, (UINT32)azx_clock_ms() - trigger_edge_ms);
+    trigger_pending = FALSE;
+  }
+  ok = send_at(cmd);
+  if(first_play)
+  {
+    boot_prof_end(BOOT_PROF_APLAY);
+    boot_prof_finish();
+    azx_metrics_log();
+    i2c_bus_log_stats();
+#ifdef AZX_TRACE_ENABLE
+    azx_trace_dump_to_file(LOCALPATH "/trace.txt");
+#endif
+    first_play = FALSE;
+  }
+  if(ok && stops)
+  {
+    /* A stop was sent while this clip was starting: it must not survive it */
+    send_at_prio(AT_PRIO_URGENT, "AT#APLAY=0\r");
+    ok = FALSE;
+  }
+  return ok;
+}
+
+/*-----------------------------------------------------------------------------------------------*/
+/*!
+  \brief Starts the next valid clip of the playlist, if any, and prefetches the one after it
+ */
+/*-----------------------------------------------------------------------------------------------*/
+static void audio_svc_play_next(void)
+{
+  const CHAR *file;
+
+  playing = FALSE;
+  while(!playing && !stops && (file = playlist_peek()) != NULL)
+  {
+    playing = audio_svc_aplay(file);
+    playlist_pop();
+  }
+  if(playing)
+  {
+    azx_metrics_observe(gap_ms, azx_elapsed_ms(done_us));
+    playlist_prefetch();
+  }
+}
+
+/*-----------------------------------------------------------------------------------------------*/
+/*!
+  \brief Queries the playback status
+
+  \return TRUE if the modem reports that no clip is playing
+ */
+/*-----------------------------------------------------------------------------------------------*/
+static BOOLEAN audio_svc_poll_done(void)
+{
+  AT_APLAY_T status;
+
+  if(send_async_at_command_prio(svc_instance, AT_PRIO_BACKGROUND, "AT#APLAY?\r", rsp, sizeof(rsp)) !=
+      M2MB_RESULT_SUCCESS)
+  {
+    return FALSE;
+  }
+  return at_parse_aplay(rsp, &status) && status.status == 0;
+}
+
+static void audio_svc_urc(const CHAR *urc)
+{
+  if(strstr(urc, AUDIO_SVC_URC_END))
+  {
+    audio_svc_post(AUDIO_SVC_DONE, 0, NULL);
+  }
+}
+
+/*-----------------------------------------------------------------------------------------------*/
+/*!
+  \brief Timer wheel callback: posts the internal request given as argument
+
+  The verify timer is periodic and re-arms itself.
+ */
+/*-----------------------------------------------------------------------------------------------*/
+static void audio_svc_tmr_cb(void *arg)
+{
+  audio_svc_post((UINT32)arg, 0, NULL);
+  if((UINT32)arg == AUDIO_SVC_VERIFY)
+  {
+    azx_timer_start(&verify_tmr, AUDIO_SVC_VERIFY_MS, audio_svc_tmr_cb, arg);
+  }
+}
+
+/*-----------------------------------------------------------------------------------------------*/
+/*!
+  \brief Arms the idle timer when playback stops, disarms it when playback starts
+ */
+/*-----------------------------------------------------------------------------------------------*/
+static void audio_svc_idle_update(void)
+{
+  if(AUDIO_SVC_IDLE_MS == 0)
+  {
+    return;
+  }
+  if(playing)
+  {
+    if(idle_armed)
+    {
+      azx_timer_cancel(&idle_tmr);
+      idle_armed = FALSE;
+    }
+  }
+  else if(!idle_armed && codec_ready && !codec_is_asleep())
+  {
+    idle_armed = azx_timer_start(&idle_tmr, AUDIO_SVC_IDLE_MS, audio_svc_tmr_cb,
+        (void *)AUDIO_SVC_IDLE);
+  }
+}
+
+static BOOLEAN audio_svc_wake(void)
+{
+  return !codec_is_asleep() || codec_wake();
+}
+
+static void audio_svc_serve(const AUDIO_SVC_MSG_T *msg)
+{
+  switch(msg->cmd)
+  {
+  case AUDIO_SVC_PLAY:
+    if(!codec_ready)
+    {
+      AZX_LOG_ERROR("Codec not ready, cannot play %s\r\n", msg->file);
+      break;
+    }
+    if(!playlist_push(msg->file))
+    {
+      AZX_LOG_WARN("Playlist full, %s dropped\r\n", msg->file);
+      break;
+    }
+    if(!playing)
+    {
+      done_us = azx_clock_us();
+      if(audio_svc_wake())
+      {
+        audio_svc_play_next();
+      }
+    }
+    else
+    {
+      playlist_prefetch();
+    }
+    break;
+  case AUDIO_SVC_TRIGGER:
+    trigger_pending = TRUE;
+    trigger_edge_ms = msg->arg;
+    /* fall through */
+  case AUDIO_SVC_PLAY_NOW:
+    if(!codec_ready)
+    {
+      AZX_LOG_ERROR("Codec not ready, cannot play %s\r\n", msg->file);
+      trigger_pending = FALSE;  /* or the next play would be timed as this trigger */
+      break;
+    }
+    if(playing)
+    {
+      send_at_prio(AT_PRIO_URGENT, "AT#APLAY=0\r");
+      skip_done = TRUE;
+    }
+    playing = audio_svc_wake() && audio_svc_aplay(msg->file);
+    break;
+  case AUDIO_SVC_DONE:
+    if(skip_done)
+    {
+      /* If the modem sends no URC on stop, the status poll still catches the real end */
+      skip_done = FALSE;
+    }
+    else if(playing)
+    {
+      done_us = azx_clock_us();
+      audio_svc_play_next();
+    }
+    break;
+  case AUDIO_SVC_STOP:
+    /* AT#APLAY=0 was already sent by audio_svc_stop() */
+    playlist_clear();
+    playing = FALSE;
+    __sync_fetch_and_sub(&stops, 1);
+    break;
+  case AUDIO_SVC_VOLUME:
+    audio_svc_wake();
+    codec_ramp_start(CODEC_REG_DAC_ATTEN, (UINT8)msg->arg, AUDIO_SVC_VOLUME_RAMP_MS, CODEC_RAMP_SMOOTH);
+    break;
+  case AUDIO_SVC_CONFIG:
+    audio_svc_wake();
+    codec_ready = modem_state_set(svc_instance, MODEM_STATE_DVI, AUDIO_SVC_DVI_CFG, NULL) &&
+        codec_write_hex(CODEC_DEFAULT_CFG);
+    break;
+  case AUDIO_SVC_PROFILE:
+    if(codec_ready && audio_svc_wake() && !codec_set_profile((CODEC_PROFILE_E)msg->arg))
+    {
+      AZX_LOG_ERROR("Cannot apply codec profile %u\r\n", msg->arg);
+    }
+    break;
+  case AUDIO_SVC_VERIFY:
+    if(codec_ready)
+    {
+      codec_verify(CODEC_VERIFY_FIRST, CODEC_VERIFY_COUNT);
+    }
+    break;
+  case AUDIO_SVC_IDLE:
+    idle_armed = FALSE;
+    if(!playing && !codec_ramp_busy())
+    {
+      codec_sleep();
+    }
+    break;
+  default:
+    AZX_LOG_WARN("Unknown audio request %u\r\n", msg->cmd);
+    break;
+  }
+}
+
+static void audio_svc_task(void *arg)
+{
+  AUDIO_SVC_MSG_T msg;
+  (void)arg;
+
+  codec_ready = audio_svc_bringup();
+  if(!codec_ready)
+  {
+    AZX_LOG_ERROR("Codec bring-up failed, waiting for a config request\r\n");
+  }
+  codec_ramp_init();
+  if(AUDIO_SVC_VERIFY_MS > 0)
+  {
+    azx_timer_start(&verify_tmr, AUDIO_SVC_VERIFY_MS, audio_svc_tmr_cb, (void *)AUDIO_SVC_VERIFY);
+  }
+
+  for(;;)
+  {
+    if(m2mb_os_q_rx(svc_q, &msg,
+        playing ? M2MB_OS_MS2TICKS(AUDIO_SVC_POLL_MS) : M2MB_OS_WAIT_FOREVER) == M2MB_OS_SUCCESS)
+    {
+      audio_svc_serve(&msg);
+    }
+    else if(playing && !stops && audio_svc_poll_done())
+    {
+      skip_done = FALSE;
+      done_us = azx_clock_us();
+      audio_svc_play_next();
+    }
+    audio_svc_idle_update();
+  }
+}
+
+static M2MB_RESULT_E audio_svc_post(UINT32 cmd, UINT32 arg, const CHAR *file)
+{
+  AUDIO_SVC_MSG_T msg;
+
+  if(!svc_q)
+  {
+    return M2MB_RESULT_FAIL;
+  }
+  memset(&msg, 0, sizeof(msg));
+  msg.cmd = cmd;
+  msg.arg = arg;
+  if(file)
+  {
+    strncpy(msg.file, file, sizeof(msg.file) - 1);
+  }
+  return (m2mb_os_q_tx(svc_q, &msg, M2MB_OS_NO_WAIT, 0) == M2MB_OS_SUCCESS) ?
+      M2MB_RESULT_SUCCESS : M2MB_RESULT_FAIL;
+}
+
+/* Global functions =============================================================================*/
+BOOLEAN audio_svc_start(INT16 instance)
+{
+  M2MB_OS_Q_ATTR_HANDLE qAttrHandle;
+  M2MB_OS_TASK_ATTR_HANDLE taskAttrHandle;
+
+  if(svc_task)
+  {
+    return TRUE;
+  }
+  svc_instance = instance;
+  gap_ms = azx_metrics_register("audio.gap_ms", AZX_METRIC_HISTOGRAM);
+  trigger_ms = azx_metrics_register("audio.trigger_ms", AZX_METRIC_HISTOGRAM);
+  if(!i2c_bus_init())
+  {
+    return FALSE;
+  }
+
+  if(m2mb_os_q_setAttrItem(&qAttrHandle, CMDS_ARGS(
+      M2MB_OS_Q_SEL_CMD_CREATE_ATTR, NULL,
+      M2MB_OS_Q_SEL_CMD_NAME, "AudioQ",
+      M2MB_OS_Q_SEL_CMD_QSTART, svc_q_area,
+      M2MB_OS_Q_SEL_CMD_MSG_SIZE, WORD32_FOR_MSG(AUDIO_SVC_MSG_T),
+      M2MB_OS_Q_SEL_CMD_QSIZE, sizeof(svc_q_area))) != M2MB_OS_SUCCESS)
+  {
+    AZX_LOG_ERROR("Cannot create audio queue attributes\r\n");
+    return FALSE;
+  }
+  if(m2mb_os_q_init(&svc_q, &qAttrHandle) != M2MB_OS_SUCCESS)
+  {
+    m2mb_os_q_setAttrItem(&qAttrHandle, 1, M2MB_OS_Q_SEL_CMD_DEL_ATTR, NULL);
+    AZX_LOG_ERROR("Cannot create audio queue\r\n");
+    svc_q = NULL;
+    return FALSE;
+  }
+
+  m2mb_os_taskSetAttrItem(&taskAttrHandle, CMDS_ARGS(
+      M2MB_OS_TASK_SEL_CMD_CREATE_ATTR, NULL,
+      M2MB_OS_TASK_SEL_CMD_STACK_SIZE, AUDIO_SVC_STACK_SIZE,
+      M2MB_OS_TASK_SEL_CMD_NAME, "AudioSvc",
+      M2MB_OS_TASK_SEL_CMD_PRIORITY, AUDIO_SVC_PRIORITY,
+      M2MB_OS_TASK_SEL_CMD_PREEMPTIONTH, AUDIO_SVC_PRIORITY,
+      M2MB_OS_TASK_SEL_CMD_AUTOSTART, M2MB_OS_TASK_AUTOSTART));
+  if(m2mb_os_taskCreate(&svc_task, &taskAttrHandle, audio_svc_task, NULL) != M2MB_OS_SUCCESS)
+  {
+    m2mb_os_taskSetAttrItem(&taskAttrHandle, 1, M2MB_OS_TASK_SEL_CMD_DEL_ATTR, NULL);
+    AZX_LOG_ERROR("Cannot create audio service task\r\n");
+    svc_task = NULL;
+    return FALSE;
+  }
+  at_cmd_async_set_urc_cb(audio_svc_urc);
+  return TRUE;
+}
+
+M2MB_RESULT_E audio_svc_play(const CHAR *file)
+{
+  return audio_svc_post(AUDIO_SVC_PLAY, 0, file);
+}
+
+M2MB_RESULT_E audio_svc_play_now(const CHAR *file)
+{
+  return audio_svc_post(AUDIO_SVC_PLAY_NOW, 0, file);
+}
+
+M2MB_RESULT_E audio_svc_stop(void)
+{
+  AUDIO_SVC_MSG_T msg;
+  CHAR stop_rsp[32];  /* rsp belongs to the service task */
+
+  if(!svc_q)
+  {
+    return M2MB_RESULT_FAIL;
+  }
+  /* Nothing starts from now until the playlist is cleared, then it is stopped from here,
+   * whatever the service task is busy with */
+  __sync_fetch_and_add(&stops, 1);
+  if(send_async_at_command_prio(svc_instance, AT_PRIO_URGENT, "AT#APLAY=0\r", stop_rsp,
+      sizeof(stop_rsp)) != M2MB_RESULT_SUCCESS)
+  {
+    AZX_LOG_WARN("Error sending command <AT#APLAY=0>\r\n");
+  }
+  /* Only the state update is queued, ahead of the requests already there */
+  memset(&msg, 0, sizeof(msg));
+  msg.cmd = AUDIO_SVC_STOP;
+  if(m2mb_os_q_tx(svc_q, &msg, M2MB_OS_NO_WAIT, M2MB_OS_Q_TX_PRIORITIZE) != M2MB_OS_SUCCESS)
+  {
+    __sync_fetch_and_sub(&stops, 1);
+    return M2MB_RESULT_FAIL;
+  }
+  return M2MB_RESULT_SUCCESS;
+}
+
+M2MB_RESULT_E audio_svc_volume(UINT8 atten)
+{
+  return audio_svc_post(AUDIO_SVC_VOLUME, atten, NULL);
+}
+
+M2MB_RESULT_E audio_svc_config(void)
+{
+  return audio_svc_post(AUDIO_SVC_CONFIG, 0, NULL);
+}
+
+M2MB_RESULT_E audio_svc_profile(UINT32 profile)
+{
+  return audio_svc_post(AUDIO_SVC_PROFILE, profile, NULL);
+}
+
+M2MB_RESULT_E audio_svc_trigger(const CHAR *file, UINT32 edge_ms)
+{
+  return audio_svc_post(AUDIO_SVC_TRIGGER, edge_ms, file);
+}
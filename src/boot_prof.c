@@ -0,0 +1,159 @@
+/**
+  @file
+    boot_prof.c
+
+  @brief
+    Boot-to-first-audio profiler
+
+  @details
+    Phase timestamps come from azx_clock_ms(), relative to power-up.
+
+  @version
+    1.0.0
+  @note
+
+
+  @date
+    19/10/2026
+*/
+/* Include files ================================================================================*/
+
+#include <string.h>
+#include "m2mb_types.h"
+#include "m2mb_os_api.h"
+#include "azx_utils.h"
+#include "m2mb_fs_stdio.h"
+
+#include "azx_log.h"
+
+#include "app_cfg.h"
+#include "boot_prof.h"
+
+/* Local defines ================================================================================*/
+#define BOOT_PROF_MAGIC   0x46525042 /* "BPRF" */
+#define BOOT_PROF_VERSION 1
+#define BOOT_PROF_UNSET   0xFFFFFFFF
+
+/* Local typedefs ===============================================================================*/
+typedef struct
+{
+  UINT32 magic;
+  UINT16 version;
+  UINT16 count;
+  CHAR sw_ver[12];
+  UINT32 total_ms;
+} BOOT_PROF_FILE_HDR_T;
+
+/* Local statics ================================================================================*/
+static const CHAR *phase_names[BOOT_PROF_PHASE_MAX] =
+{
+  "sleep", "ati", "gps", "vaux", "gpio", "dvi", "i2c", "ate0", "aplay"
+};
+
+static BOOT_PROF_PHASE_T phases[BOOT_PROF_PHASE_MAX];
+static BOOT_PROF_PHASE_T prev_phases[BOOT_PROF_PHASE_MAX];
+
+/* Local function prototypes ====================================================================*/
+static UINT32 now_ms(void);
+static BOOLEAN load_previous(void);
+
+/* Static functions =============================================================================*/
+static UINT32 now_ms(void)
+{
+  return (UINT32)azx_clock_ms();
+}
+
+static BOOLEAN load_previous(void)
+{
+  BOOT_PROF_FILE_HDR_T hdr;
+  M2MB_FILE_T *fd = m2mb_fs_fopen(BOOT_PROF_FILE, "rb");
+  BOOLEAN ok = FALSE;
+
+  if(!fd)
+  {
+    return FALSE;
+  }
+  if(m2mb_fs_fread(&hdr, sizeof(hdr), 1, fd) == 1 &&
+      hdr.magic == BOOT_PROF_MAGIC && hdr.version == BOOT_PROF_VERSION &&
+      hdr.count == BOOT_PROF_PHASE_MAX)
+  {
+    ok = (m2mb_fs_fread(prev_phases, sizeof(prev_phases), 1, fd) == 1);
+  }
+  m2mb_fs_fclose(fd);
+  return ok;
+}
+
+/* Global functions =============================================================================*/
+void boot_prof_init(void)
+{
+  memset(phases, 0xFF, sizeof(phases));
+}
+
+void boot_prof_begin(BOOT_PROF_PHASE_E phase)
+{
+  if(phase < BOOT_PROF_PHASE_MAX)
+  {
+    phases[phase].start_ms = now_ms();
+  }
+}
+
+void boot_prof_end(BOOT_PROF_PHASE_E phase)
+{
+  if(phase < BOOT_PROF_PHASE_MAX && phases[phase].start_ms != BOOT_PROF_UNSET)
+  {
+    phases[phase].duration_ms = now_ms() - phases[phase].start_ms;
+  }
+}
+
+const BOOT_PROF_PHASE_T* boot_prof_get(BOOT_PROF_PHASE_E phase)
+{
+  return (phase < BOOT_PROF_PHASE_MAX) ? &phases[phase] : NULL;
+}
+
+BOOLEAN boot_prof_finish(void)
+{
+  BOOT_PROF_FILE_HDR_T hdr;
+  M2MB_FILE_T *fd;
+  BOOLEAN have_prev;
+  BOOLEAN written = FALSE;
+  UINT32 i;
+
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.magic = BOOT_PROF_MAGIC;
+  hdr.version = BOOT_PROF_VERSION;
+  hdr.count = BOOT_PROF_PHASE_MAX;
+  strncpy(hdr.sw_ver, VERSION, sizeof(hdr.sw_ver) - 1);
+  hdr.total_ms = now_ms();
+
+  have_prev = load_previous();
+
+  AZX_LOG_INFO("Boot profile v%s: first audio at %u ms from power-up\r\n", VERSION, hdr.total_ms);
+  for(i = 0; i < BOOT_PROF_PHASE_MAX; i++)
+  {
+    if(phases[i].duration_ms == BOOT_PROF_UNSET)
+    {
+      AZX_LOG_INFO("  %-5s       -\r\n", phase_names[i]);
+    }
+    else if(have_prev && prev_phases[i].duration_ms != BOOT_PROF_UNSET)
+    {
+      AZX_LOG_INFO("  %-5s @%6u %6u ms (%+d)\r\n", phase_names[i], phases[i].start_ms,
+          phases[i].duration_ms, (INT32)(phases[i].duration_ms - prev_phases[i].duration_ms));
+    }
+    else
+    {
+      AZX_LOG_INFO("  %-5s @%6u %6u ms\r\n", phase_names[i], phases[i].start_ms,
+          phases[i].duration_ms);
+    }
+  }
+
+  fd = m2mb_fs_fopen(BOOT_PROF_FILE, "wb");
+  if(!fd)
+  {
+    AZX_LOG_ERROR("Cannot open %s\r\n", BOOT_PROF_FILE);
+    return FALSE;
+  }
+  written = (m2mb_fs_fwrite(&hdr, sizeof(hdr), 1, fd) == 1) &&
+      (m2mb_fs_fwrite(phases, sizeof(phases), 1, fd) == 1);
+  m2mb_fs_fclose(fd);
+  return written;
+}
@@ -0,0 +1,471 @@
+/**
+  @file
+    codec.c
+
+  @brief
+    MAX9860 audio codec driver
+
+  @details
+    Register access goes through the I2C bus scheduler (i2c_bus.h), in the
+    audio priority class. Register readbacks are a single combined write-read
+    transaction. The bus session stays open between calls.
+
+  @version
+    1.1.0
+  @note
+
+
+  @date
+    19/10/2026
+*/
+/* Include files ================================================================================*/
+
+#include <string.h>
+#include "m2mb_types.h"
+
+#include "azx_log.h"
+#include "azx_trace.h"
+#include "azx_metrics.h"
+#include "azx_utils.h"
+
+#include "i2c_bus.h"
+#include "codec.h"
+
+/* Local defines ================================================================================*/
+#define CODEC_MAX_MSG 64
+
+/* Registers 0x00..0x10 */
+#define CODEC_REG_COUNT 0x11
+
+/* First register rewritten on wake: 0x00 and 0x01 are read-only */
+#define CODEC_WAKE_FIRST 0x02
+
+#ifndef I2C_BUS_M2MB
+#define CODEC_BACKEND_NAME "i2c-dev"
+#else
+#define CODEC_BACKEND_NAME "m2mb_i2c"
+#endif
+
+/* Local typedefs ===============================================================================*/
+/* Local statics ================================================================================*/
+static INT32 i2c_dev = -1;
+static AZX_METRIC_T *i2c_writes;
+static AZX_METRIC_T *i2c_reads;
+static AZX_METRIC_T *i2c_failures;
+static AZX_METRIC_T *restores;
+static AZX_METRIC_T *reclock_us;
+static AZX_METRIC_T *shutdown_ms;
+static AZX_METRIC_T *wake_us;
+
+static BOOLEAN asleep = FALSE;
+static UINT64 sleep_start;
+
+/* Clock registers 0x03..0x05 per profile, MCLK 12.288 MHz, N = 65536 * 96 * fs / PCLK */
+static const UINT8 profiles[CODEC_PROFILE_MAX][CODEC_PROFILE_REGS] =
+{
+  { 0x10, 0x10, 0x00 },                   /* CODEC_PROFILE_NB: 8 kHz, as CODEC_DEFAULT_CFG */
+  { 0x10 | CODEC_SYSCLK_16KHZ, 0x20, 0x00 }, /* CODEC_PROFILE_WB: 16 kHz */
+  { 0x10 | CODEC_SYSCLK_16KHZ, 0x40, 0x00 }  /* CODEC_PROFILE_PROMPT: 32 kHz */
+};
+
+/* Intended configuration, as last written */
+static UINT8 shadow[CODEC_REG_COUNT];
+static BOOLEAN shadow_known[CODEC_REG_COUNT];
+
+/* Local function prototypes ====================================================================*/
+static int char2int(char input);
+static int hex2bin(const char* src, char* target);
+static BOOLEAN codec_xfer_write(const UINT8 *data, int len);
+static BOOLEAN codec_write(const UINT8 *data, int len);
+static void shadow_update(const UINT8 *data, int len);
+static INT32 write_runs(UINT8 first, const UINT8 *target, const UINT8 *current, UINT8 count);
+
+/* Static functions =============================================================================*/
+static int char2int(char input) {
+    if(input >= '0' && input <= '9') return input - '0';
+    if(input >= 'A' && input <= 'F') return input - 'A' + 10;
+    if(input >= 'a' && input <= 'f') return input - 'a' + 10;
+    return -1;
+}
+
+// This function assumes src to be a zero terminated sanitized string with
+// an even number of [0-9a-f] characters, and target to be sufficiently large
+static int hex2bin(const char* src, char* target) {
+    while(src[0] && src[1]) {
+        int a = char2int(src[0]);
+        int b = char2int(src[1]);
+        if (a < 0 || b < 0) return -1;
+        *(target++) = a*16 + b;
+        src += 2;
+    }
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------------------------*/
+/*!
+  \brief Writes a raw I2C message without recording it as intended configuration
+ */
+/*-----------------------------------------------------------------------------------------------*/
+static BOOLEAN codec_xfer_write(const UINT8 *data, int len)
+{
+  if(!codec_open())
+  {
+    return FALSE;
+  }
+  AZX_TRACE_BEGIN_EVT("i2c_write");
+  AZX_METRICS_INC(i2c_writes);
+  if(!i2c_bus_xfer(i2c_dev, data, len, NULL, 0))
+  {
+    AZX_TRACE_END_EVT("i2c_write");
+    AZX_METRICS_INC(i2c_failures);
+    AZX_LOG_ERROR("Failed to write to the i2c bus\r\n");
+    return FALSE;
+  }
+  AZX_TRACE_END_EVT("i2c_write");
+  return TRUE;
+}
+
+static BOOLEAN codec_write(const UINT8 *data, int len)
+{
+  if(!codec_xfer_write(data, len))
+  {
+    return FALSE;
+  }
+  shadow_update(data, len);
+  return TRUE;
+}
+
+static void shadow_update(const UINT8 *data, int len)
+{
+  int i;
+
+  for(i = 1; i < len && data[0] + i - 1 < CODEC_REG_COUNT; i++)
+  {
+    shadow[data[0] + i - 1] = data[i];
+    shadow_known[data[0] + i - 1] = TRUE;
+  }
+}
+
+/*-----------------------------------------------------------------------------------------------*/
+/*!
+  \brief Writes target values where they differ from current ones, one burst per run
+
+  \return The number of registers written, -1 on bus failure
+ */
+/*-----------------------------------------------------------------------------------------------*/
+static INT32 write_runs(UINT8 first, const UINT8 *target, const UINT8 *current, UINT8 count)
+{
+  UINT8 run[CODEC_REG_COUNT + 1];
+  INT32 written = 0;
+  UINT8 i = 0, j;
+
+  while(i < count)
+  {
+    if(target[i] == current[i])
+    {
+      i++;
+      continue;
+    }
+    run[0] = first + i;
+    for(j = i; j < count && target[j] != current[j]; j++)
+    {
+      run[j - i + 1] = target[j];
+    }
+    if(!codec_write(run, j - i + 1))
+    {
+      return -1;
+    }
+    written += j - i;
+    i = j;
+  }
+  return written;
+}
+
+/* Global functions =============================================================================*/
+BOOLEAN codec_open(void)
+{
+  if(i2c_dev >= 0)
+  {
+    return TRUE;
+  }
+  if(!i2c_writes)
+  {
+    i2c_writes = azx_metrics_register("codec.i2c_writes", AZX_METRIC_COUNTER);
+    i2c_reads = azx_metrics_register("codec.i2c_reads", AZX_METRIC_COUNTER);
+    i2c_failures = azx_metrics_register("codec.i2c_failures", AZX_METRIC_COUNTER);
+    restores = azx_metrics_register("codec.restored_regs", AZX_METRIC_COUNTER);
+  }
+  if(!i2c_bus_init() || (i2c_dev = i2c_bus_register("codec", CODEC_I2C_ADDR, I2C_BUS_PRIO_AUDIO)) < 0)
+  {
+    AZX_METRICS_INC(i2c_failures);
+    return FALSE;
+  }
+  return TRUE;
+}
+
+void codec_close(void)
+{
+  i2c_bus_reset(i2c_dev);
+}
+
+BOOLEAN codec_write_hex(const CHAR *str)
+{
+  char data[CODEC_MAX_MSG];
+  int len = strlen(str) / 2;
+
+  memset(data, 0, sizeof(data));
+  if(len > CODEC_MAX_MSG || hex2bin(str, data) < 0)
+  {
+    return FALSE;
+  }
+  AZX_LOG_DEBUG("writing to i2c %s : %d bytes\r\n", str, len);
+  return codec_write((const UINT8*)data, len);
+}
+
+BOOLEAN codec_write_reg(UINT8 reg, UINT8 val)
+{
+  UINT8 data[2] = { reg, val };
+
+  return codec_write(data, sizeof(data));
+}
+
+BOOLEAN codec_read_regs(UINT8 reg, UINT8 *val, UINT8 count)
+{
+  if(!codec_open())
+  {
+    return FALSE;
+  }
+  AZX_TRACE_BEGIN_EVT("i2c_read");
+  AZX_METRICS_INC(i2c_reads);
+  if(!i2c_bus_xfer(i2c_dev, &reg, 1, val, count))
+  {
+    AZX_TRACE_END_EVT("i2c_read");
+    AZX_METRICS_INC(i2c_failures);
+    AZX_LOG_ERROR("Failed to read register 0x%02X from the i2c bus\r\n", reg);
+    return FALSE;
+  }
+  AZX_TRACE_END_EVT("i2c_read");
+  return TRUE;
+}
+
+BOOLEAN codec_get_cached(UINT8 reg, UINT8 *val)
+{
+  if(reg >= CODEC_REG_COUNT || !shadow_known[reg])
+  {
+    return FALSE;
+  }
+  *val = shadow[reg];
+  return TRUE;
+}
+
+BOOLEAN codec_read_reg(UINT8 reg, UINT8 *val)
+{
+  return codec_read_regs(reg, val, 1);
+}
+
+INT32 codec_verify(UINT8 first, UINT8 count)
+{
+  UINT8 val[CODEC_REG_COUNT];
+  INT32 restored;
+  UINT8 i;
+
+  if(count == 0 || first >= CODEC_REG_COUNT || asleep)
+  {
+    return 0;
+  }
+  if(first + count > CODEC_REG_COUNT)
+  {
+    count = CODEC_REG_COUNT - first;
+  }
+  if(!codec_read_regs(first, val, count))
+  {
+    return -1;
+  }
+  for(i = 0; i < count; i++)
+  {
+    if(!shadow_known[first + i])
+    {
+      /* Never written: nothing to compare against */
+      val[i] = shadow[first + i];
+    }
+  }
+  restored = write_runs(first, &shadow[first], val, count);
+  if(restored > 0)
+  {
+    AZX_LOG_WARN("Codec lost %d registers, restored\r\n", restored);
+    azx_metrics_add(restores, restored);
+  }
+  return restored;
+}
+
+BOOLEAN codec_set_profile(CODEC_PROFILE_E profile)
+{
+  UINT8 mute[2] = { CODEC_REG_DAC_ATTEN, CODEC_DAC_MUTE };
+  UINT8 pwr[2] = { CODEC_REG_PWRMAN, 0 };
+  UINT8 status = CODEC_STATUS_ULK;
+  UINT64 start;
+  UINT32 elapsed;
+  BOOLEAN ok;
+
+  if(profile >= CODEC_PROFILE_MAX || !shadow_known[CODEC_REG_PWRMAN])
+  {
+    return FALSE;
+  }
+  if(!reclock_us)
+  {
+    reclock_us = azx_metrics_register("codec.reclock_us", AZX_METRIC_HISTOGRAM);
+  }
+  if(memcmp(&shadow[CODEC_REG_SYSCLK], profiles[profile], CODEC_PROFILE_REGS) == 0)
+  {
+    return TRUE;
+  }
+  start = azx_clock_us();
+
+  /* Mute and shut down around the clock change; the shadow keeps the intended values */
+  pwr[1] = shadow[CODEC_REG_PWRMAN] & ~CODEC_PWRMAN_SHDN;
+  ok = codec_xfer_write(mute, sizeof(mute)) && codec_xfer_write(pwr, sizeof(pwr));
+  ok = ok && write_runs(CODEC_REG_SYSCLK, profiles[profile], &shadow[CODEC_REG_SYSCLK],
+      CODEC_PROFILE_REGS) >= 0;
+  pwr[1] = shadow[CODEC_REG_PWRMAN];
+  ok = ok && codec_xfer_write(pwr, sizeof(pwr));
+
+  /* Wait for the PLL to lock instead of sleeping blindly */
+  while(ok && (status & CODEC_STATUS_ULK) &&
+      !AZX_CLOCK_EXPIRED(start, CODEC_PLL_LOCK_TIMEOUT_MS * 1000))
+  {
+    ok = codec_read_reg(CODEC_REG_STATUS, &status);
+  }
+  if(ok && (status & CODEC_STATUS_ULK))
+  {
+    AZX_LOG_WARN("Codec PLL not locked after %u ms\r\n", CODEC_PLL_LOCK_TIMEOUT_MS);
+  }
+
+  mute[1] = shadow[CODEC_REG_DAC_ATTEN];
+  ok = codec_xfer_write(mute, sizeof(mute)) && ok;
+  elapsed = azx_elapsed_us(start);
+  azx_metrics_observe(reclock_us, elapsed);
+  AZX_LOG_DEBUG("Codec profile %d applied in %u us\r\n", profile, elapsed);
+  return ok;
+}
+
+BOOLEAN codec_sleep(void)
+{
+  UINT8 pwr[2] = { CODEC_REG_PWRMAN, 0 };
+
+  if(asleep || !shadow_known[CODEC_REG_PWRMAN])
+  {
+    return asleep;
+  }
+  if(!shutdown_ms)
+  {
+    shutdown_ms = azx_metrics_register("codec.shutdown_ms", AZX_METRIC_COUNTER);
+    wake_us = azx_metrics_register("codec.wake_us", AZX_METRIC_HISTOGRAM);
+  }
+  /* The shadow keeps SHDN set: it is the state to restore on wake */
+  pwr[1] = shadow[CODEC_REG_PWRMAN] & ~CODEC_PWRMAN_SHDN;
+  if(!codec_xfer_write(pwr, sizeof(pwr)))
+  {
+    return FALSE;
+  }
+  asleep = TRUE;
+  sleep_start = azx_clock_us();
+  AZX_LOG_DEBUG("Codec shut down\r\n");
+  return TRUE;
+}
+
+BOOLEAN codec_wake(void)
+{
+  UINT8 burst[CODEC_REG_COUNT - CODEC_WAKE_FIRST + 1];
+  UINT64 start;
+  UINT32 elapsed;
+  UINT8 reg;
+
+  if(!asleep)
+  {
+    return TRUE;
+  }
+  start = azx_clock_us();
+
+  /* Registers keep their content in shutdown, but a supply dip may have reset
+   * them: rewrite the whole cached state, SHDN included, in one burst */
+  burst[0] = CODEC_WAKE_FIRST;
+  for(reg = CODEC_WAKE_FIRST; reg < CODEC_REG_COUNT; reg++)
+  {
+    if(!shadow_known[reg])
+    {
+      break;
+    }
+    burst[reg - CODEC_WAKE_FIRST + 1] = shadow[reg];
+  }
+  if(reg == CODEC_REG_COUNT)
+  {
+    if(!codec_xfer_write(burst, sizeof(burst)))
+    {
+      return FALSE;
+    }
+  }
+  else
+  {
+    burst[0] = CODEC_REG_PWRMAN;
+    burst[1] = shadow[CODEC_REG_PWRMAN];
+    if(!codec_xfer_write(burst, 2))
+    {
+      return FALSE;
+    }
+  }
+  asleep = FALSE;
+  elapsed = azx_elapsed_us(start);
+  azx_metrics_add(shutdown_ms, (UINT32)((start - sleep_start) / 1000));
+  azx_metrics_observe(wake_us, elapsed);
+  AZX_LOG_DEBUG("Codec woken in %u us after %u ms of shutdown\r\n",
+      elapsed, (UINT32)((start - sleep_start) / 1000));
+  return TRUE;
+}
+
+BOOLEAN codec_is_asleep(void)
+{
+  return asleep;
+}
+
+void codec_bench(UINT32 count)
+{
+  AZX_METRIC_T *xfer_us;
+  UINT64 start;
+  UINT32 i, each, failures = 0;
+  UINT8 atten = 0;
+
+  if(count == 0 || !codec_read_reg(CODEC_REG_DAC_ATTEN, &atten))
+  {
+    return;
+  }
+  xfer_us = azx_metrics_register("codec.bench_xfer_us", AZX_METRIC_HISTOGRAM);
+
+  /* Write back the current value and read it again: no audible effect */
+  start = azx_clock_us();
+  for(i = 0; i < count; i++)
+  {
+    if(!codec_write_reg(CODEC_REG_DAC_ATTEN, atten))
+    {
+      failures++;
+    }
+  }
+  each = azx_elapsed_us(start) / count;
+  azx_metrics_observe(xfer_us, each);
+  AZX_LOG_INFO("[%s] write: %u transactions, %u us each, %u failed\r\n", CODEC_BACKEND_NAME,
+      count, each, failures);
+
+  failures = 0;
+  start = azx_clock_us();
+  for(i = 0; i < count; i++)
+  {
+    UINT8 val;
+    if(!codec_read_reg(CODEC_REG_DAC_ATTEN, &val) || val != atten)
+    {
+      failures++;
+    }
+  }
+  each = azx_elapsed_us(start) / count;
+  azx_metrics_observe(xfer_us, each);
+  AZX_LOG_INFO("[%s] write-read: %u transactions, %u us each, %u failed\r\n", CODEC_BACKEND_NAME,
+      count, each, failures);
+}
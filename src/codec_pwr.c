@@ -0,0 +1,109 @@
+/**
+  @file
+    codec_pwr.c
+
+  @brief
+    Codec power sequencing
+
+  @details
+    GPIO7 stays open for the lifetime of the application, so that toggling
+    it later costs a single m2mb_gpio_write().
+
+  @version
+    1.0.0
+  @note
+
+
+  @date
+    19/10/2026
+*/
+/* Include files ================================================================================*/
+
+#include <string.h>
+#include "m2mb_types.h"
+#include "m2mb_os_api.h"
+#include "m2mb_gpio.h"
+
+#include "azx_log.h"
+#include "azx_metrics.h"
+#include "azx_utils.h"
+
+#include "modem_state.h"
+#include "codec_pwr.h"
+
+/* Local defines ================================================================================*/
+/* Local typedefs ===============================================================================*/
+/* Local statics ================================================================================*/
+static INT32 gpio_fd = -1;
+
+/* Local function prototypes ====================================================================*/
+/* Static functions =============================================================================*/
+/* Global functions =============================================================================*/
+BOOLEAN codec_pwr_vaux_on(INT16 instance)
+{
+  BOOLEAN sent = FALSE;
+
+  if(!modem_state_set(instance, MODEM_STATE_VAUX, "1", &sent))
+  {
+    AZX_LOG_ERROR("Cannot switch VAUX on\r\n");
+    return FALSE;
+  }
+  if(sent)
+  {
+    azx_delay_us(CODEC_PWR_VAUX_SETTLE_US);
+  }
+  return TRUE;
+}
+
+BOOLEAN codec_pwr_enable(void)
+{
+  AZX_METRIC_T *at_latency;
+  UINT64 start = azx_clock_us();
+  UINT32 elapsed;
+  UINT32 at_cost = 0;
+
+  if(gpio_fd == -1)
+  {
+    gpio_fd = m2mb_gpio_open(CODEC_PWR_GPIO, 0);
+    if(gpio_fd == -1)
+    {
+      AZX_LOG_ERROR("Cannot open %s\r\n", CODEC_PWR_GPIO);
+      return FALSE;
+    }
+    if(m2mb_gpio_multi_ioctl(gpio_fd, CMDS_ARGS(
+        M2MB_GPIO_IOCTL_SET_DIR, M2MB_GPIO_MODE_OUTPUT,
+        M2MB_GPIO_IOCTL_SET_PULL, M2MB_GPIO_PULL_KEEPER,
+        M2MB_GPIO_IOCTL_SET_DRIVE, M2MB_GPIO_MEDIUM_DRIVE)) == -1)
+    {
+      AZX_LOG_ERROR("Cannot configure %s\r\n", CODEC_PWR_GPIO);
+      m2mb_gpio_close(gpio_fd);
+      gpio_fd = -1;
+      return FALSE;
+    }
+  }
+  if(m2mb_gpio_write(gpio_fd, M2MB_GPIO_HIGH_VALUE) == -1)
+  {
+    AZX_LOG_ERROR("Cannot drive %s high\r\n", CODEC_PWR_GPIO);
+    return FALSE;
+  }
+  azx_delay_us(CODEC_PWR_ENABLE_SETTLE_US);
+  elapsed = azx_elapsed_ms(start);
+
+  /* An AT#GPIO would have cost one AT round trip plus the same settle time */
+  at_latency = azx_metrics_register("at.latency_ms", AZX_METRIC_HISTOGRAM);
+  if(at_latency && at_latency->value)
+  {
+    at_cost = at_latency->sum / at_latency->value + CODEC_PWR_ENABLE_SETTLE_US / 1000;
+  }
+  AZX_LOG_INFO("Codec enabled in %u ms, about %d ms saved against AT#GPIO\r\n",
+      elapsed, (INT32)(at_cost - elapsed));
+  return TRUE;
+}
+
+void codec_pwr_disable(void)
+{
+  if(gpio_fd != -1)
+  {
+    m2mb_gpio_write(gpio_fd, M2MB_GPIO_LOW_VALUE);
+  }
+}
@@ -0,0 +1,302 @@
+/**
+  @file
+    codec_ramp.c
+
+  @brief
+    Click-free codec gain ramps
+
+  @details
+    The hardware timer callback must stay short: it never touches the bus, it
+    only posts register values to the worker queue. Each ramp gets a new
+    generation number, so that the steps of a cancelled ramp still in the
+    queue are recognized and dropped by the worker.
+
+  @version
+    1.0.0
+  @note
+
+
+  @date
+    19/10/2026
+*/
+/* Include files ================================================================================*/
+
+#include <string.h>
+#include "m2mb_types.h"
+#include "m2mb_os_api.h"
+#include "m2mb_hwTmr.h"
+
+#include "azx_log.h"
+#include "azx_metrics.h"
+
+#include "codec.h"
+#include "codec_ramp.h"
+
+/* Local defines ================================================================================*/
+#define RAMP_STACK_SIZE 4096
+#define RAMP_PRIORITY   199  /* just above the audio service */
+
+/* Two ramps' worth of steps: the tail of a cancelled one plus a new one */
+#define RAMP_QUEUE_LEN  (2 * CODEC_RAMP_MAX_STEPS)
+
+/* Fixed point scale of the ramp progress */
+#define RAMP_ONE        1024
+
+/* Local typedefs ===============================================================================*/
+typedef struct
+{
+  UINT8 reg;
+  UINT8 val;
+  UINT16 spare;
+  UINT32 gen;
+} RAMP_MSG_T;
+
+/* Local statics ================================================================================*/
+static M2MB_OS_TASK_HANDLE ramp_task = NULL;
+static M2MB_OS_Q_HANDLE ramp_q = NULL;
+static UINT32 ramp_q_area[RAMP_QUEUE_LEN * WORD32_FOR_MSG(RAMP_MSG_T)];
+static M2MB_HWTMR_HANDLE ramp_tmr = NULL;
+static AZX_METRIC_T *ramp_steps;
+
+static struct
+{
+  UINT8 reg;
+  INT32 from;
+  INT32 to;
+  UINT32 steps;
+  UINT32 step;
+  CODEC_RAMP_CURVE_E curve;
+  INT32 last;
+} ramp;
+
+static volatile UINT32 ramp_gen = 0;
+static volatile BOOLEAN running = FALSE;
+static volatile INT32 pending = 0;
+
+/* Local function prototypes ====================================================================*/
+static INT32 ramp_decode(UINT8 reg, UINT8 val);
+static UINT8 ramp_encode(UINT8 reg, INT32 level);
+static INT32 ramp_value(UINT32 step);
+static void ramp_tmr_cb(M2MB_HWTMR_HANDLE handle, void *arg);
+static void ramp_worker(void *arg);
+
+/* Static functions =============================================================================*/
+/*-----------------------------------------------------------------------------------------------*/
+/*!
+  \brief Converts a register value to the level the ramp works on
+ */
+/*-----------------------------------------------------------------------------------------------*/
+static INT32 ramp_decode(UINT8 reg, UINT8 val)
+{
+  return (reg == CODEC_REG_ADC_LEVEL) ? (val & 0x0F) : val;
+}
+
+static UINT8 ramp_encode(UINT8 reg, INT32 level)
+{
+  return (reg == CODEC_REG_ADC_LEVEL) ? (UINT8)((level << 4) | level) : (UINT8)level;
+}
+
+static INT32 ramp_value(UINT32 step)
+{
+  INT32 p = (INT32)(step * RAMP_ONE / ramp.steps);
+  INT32 f;
+
+  switch(ramp.curve)
+  {
+  case CODEC_RAMP_SMOOTH:
+    f = p * p / RAMP_ONE * (3 * RAMP_ONE - 2 * p) / RAMP_ONE;
+    break;
+  case CODEC_RAMP_FAST:
+    f = p * (2 * RAMP_ONE - p) / RAMP_ONE;
+    break;
+  case CODEC_RAMP_LINEAR:
+  default:
+    f = p;
+    break;
+  }
+  return ramp.from + (ramp.to - ramp.from) * f / RAMP_ONE;
+}
+
+static void ramp_tmr_cb(M2MB_HWTMR_HANDLE handle, void *arg)
+{
+  RAMP_MSG_T msg;
+  INT32 val;
+  (void)arg;
+
+  if(!running)
+  {
+    return;
+  }
+  ramp.step++;
+  val = ramp_value(ramp.step);
+  if(val != ramp.last)
+  {
+    msg.reg = ramp.reg;
+    msg.val = ramp_encode(ramp.reg, val);
+    msg.spare = 0;
+    msg.gen = ramp_gen;
+    if(m2mb_os_q_tx(ramp_q, &msg, M2MB_OS_NO_WAIT, 0) == M2MB_OS_SUCCESS)
+    {
+      __sync_fetch_and_add(&pending, 1);
+      ramp.last = val;
+    }
+  }
+  if(ramp.step >= ramp.steps)
+  {
+    running = FALSE;
+    m2mb_hwTmr_stop(handle);
+  }
+}
+
+static void ramp_worker(void *arg)
+{
+  RAMP_MSG_T msg;
+  (void)arg;
+
+  for(;;)
+  {
+    if(m2mb_os_q_rx(ramp_q, &msg, M2MB_OS_WAIT_FOREVER) != M2MB_OS_SUCCESS)
+    {
+      continue;
+    }
+    if(msg.gen == ramp_gen)
+    {
+      codec_write_reg(msg.reg, msg.val);
+      AZX_METRICS_INC(ramp_steps);
+    }
+    __sync_fetch_and_sub(&pending, 1);
+  }
+}
+
+/* Global functions =============================================================================*/
+BOOLEAN codec_ramp_init(void)
+{
+  M2MB_OS_Q_ATTR_HANDLE qAttrHandle;
+  M2MB_OS_TASK_ATTR_HANDLE taskAttrHandle;
+  M2MB_HWTMR_ATTR_HANDLE tmrAttrHandle;
+
+  if(ramp_task)
+  {
+    return TRUE;
+  }
+  ramp_steps = azx_metrics_register("codec.ramp_steps", AZX_METRIC_COUNTER);
+
+  if(m2mb_os_q_setAttrItem(&qAttrHandle, CMDS_ARGS(
+      M2MB_OS_Q_SEL_CMD_CREATE_ATTR, NULL,
+      M2MB_OS_Q_SEL_CMD_NAME, "RampQ",
+      M2MB_OS_Q_SEL_CMD_QSTART, ramp_q_area,
+      M2MB_OS_Q_SEL_CMD_MSG_SIZE, WORD32_FOR_MSG(RAMP_MSG_T),
+      M2MB_OS_Q_SEL_CMD_QSIZE, sizeof(ramp_q_area))) != M2MB_OS_SUCCESS)
+  {
+    AZX_LOG_ERROR("Cannot create ramp queue attributes\r\n");
+    return FALSE;
+  }
+  if(m2mb_os_q_init(&ramp_q, &qAttrHandle) != M2MB_OS_SUCCESS)
+  {
+    m2mb_os_q_setAttrItem(&qAttrHandle, 1, M2MB_OS_Q_SEL_CMD_DEL_ATTR, NULL);
+    AZX_LOG_ERROR("Cannot create ramp queue\r\n");
+    ramp_q = NULL;
+    return FALSE;
+  }
+
+  if(m2mb_hwTmr_setAttrItem(&tmrAttrHandle, 1, M2MB_HWTMR_SEL_CMD_CREATE_ATTR, NULL) != M2MB_HWTMR_SUCCESS ||
+      m2mb_hwTmr_setAttrItem(&tmrAttrHandle, CMDS_ARGS(
+          M2MB_HWTMR_SEL_CMD_CB_FUNC, &ramp_tmr_cb,
+          M2MB_HWTMR_SEL_CMD_ARG_CB, NULL,
+          M2MB_HWTMR_SEL_CMD_TIME_DURATION, CODEC_RAMP_MIN_STEP_US,
+          M2MB_HWTMR_SEL_CMD_PERIODIC, M2MB_HWTMR_PERIODIC_TMR,
+          M2MB_HWTMR_SEL_CMD_AUTOSTART, M2MB_HWTMR_NOT_START)) != M2MB_HWTMR_SUCCESS ||
+      m2mb_hwTmr_init(&ramp_tmr, &tmrAttrHandle) != M2MB_HWTMR_SUCCESS)
+  {
+    AZX_LOG_ERROR("Cannot create ramp timer\r\n");
+    ramp_tmr = NULL;
+    return FALSE;
+  }
+
+  m2mb_os_taskSetAttrItem(&taskAttrHandle, CMDS_ARGS(
+      M2MB_OS_TASK_SEL_CMD_CREATE_ATTR, NULL,
+      M2MB_OS_TASK_SEL_CMD_STACK_SIZE, RAMP_STACK_SIZE,
+      M2MB_OS_TASK_SEL_CMD_NAME, "CodecRamp",
+      M2MB_OS_TASK_SEL_CMD_PRIORITY, RAMP_PRIORITY,
+      M2MB_OS_TASK_SEL_CMD_PREEMPTIONTH, RAMP_PRIORITY,
+      M2MB_OS_TASK_SEL_CMD_AUTOSTART, M2MB_OS_TASK_AUTOSTART));
+  if(m2mb_os_taskCreate(&ramp_task, &taskAttrHandle, ramp_worker, NULL) != M2MB_OS_SUCCESS)
+  {
+    m2mb_os_taskSetAttrItem(&taskAttrHandle, 1, M2MB_OS_TASK_SEL_CMD_DEL_ATTR, NULL);
+    AZX_LOG_ERROR("Cannot create ramp task\r\n");
+    ramp_task = NULL;
+    return FALSE;
+  }
+  return TRUE;
+}
+
+BOOLEAN codec_ramp_start(UINT8 reg, UINT8 target, UINT32 duration_ms, CODEC_RAMP_CURVE_E curve)
+{
+  UINT8 cached;
+  UINT32 steps, max_steps;
+
+  if(reg != CODEC_REG_DAC_ATTEN && reg != CODEC_REG_ADC_LEVEL)
+  {
+    return FALSE;
+  }
+  codec_ramp_cancel();
+  if(!ramp_task || duration_ms == 0 || !codec_get_cached(reg, &cached))
+  {
+    return codec_write_reg(reg, ramp_encode(reg, target));
+  }
+
+  ramp.reg = reg;
+  ramp.from = ramp_decode(reg, cached);
+  ramp.to = (reg == CODEC_REG_ADC_LEVEL) ? (target & 0x0F) : target;
+  if(ramp.from == ramp.to)
+  {
+    return TRUE;
+  }
+  steps = (UINT32)((ramp.to > ramp.from) ? ramp.to - ramp.from : ramp.from - ramp.to);
+  max_steps = duration_ms * 1000 / CODEC_RAMP_MIN_STEP_US;
+  if(steps > max_steps)
+  {
+    steps = max_steps;
+  }
+  if(steps > CODEC_RAMP_MAX_STEPS)
+  {
+    steps = CODEC_RAMP_MAX_STEPS;
+  }
+  if(steps == 0)
+  {
+    steps = 1;
+  }
+  ramp.steps = steps;
+  ramp.step = 0;
+  ramp.curve = curve;
+  ramp.last = ramp.from;
+
+  if(m2mb_hwTmr_setItem(ramp_tmr, M2MB_HWTMR_SEL_CMD_TIME_DURATION,
+      (void *)(duration_ms * 1000 / steps)) != M2MB_HWTMR_SUCCESS)
+  {
+    return FALSE;
+  }
+  running = TRUE;
+  if(m2mb_hwTmr_start(ramp_tmr) != M2MB_HWTMR_SUCCESS)
+  {
+    running = FALSE;
+    return FALSE;
+  }
+  return TRUE;
+}
+
+void codec_ramp_cancel(void)
+{
+  if(!ramp_tmr)
+  {
+    return;
+  }
+  running = FALSE;
+  m2mb_hwTmr_stop(ramp_tmr);
+  __sync_fetch_and_add(&ramp_gen, 1);
+}
+
+BOOLEAN codec_ramp_busy(void)
+{
+  return running || pending > 0;
+}
@@ -0,0 +1,179 @@
+/**
+  @file
+    gpio_input.c
+
+  @brief
+    Push-to-play GPIO inputs
+
+  @details
+    The interrupt callback and the timer callback run outside of any task
+    context: they only take timestamps, restart the timer and post to the
+    reactor, whose handler reads the pin and posts to the audio service.
+
+  @version
+    1.0.0
+  @note
+
+
+  @date
+    19/10/2026
+*/
+/* Include files ================================================================================*/
+
+#include <stdio.h>
+#include <string.h>
+#include "m2mb_types.h"
+#include "m2mb_os_api.h"
+#include "m2mb_gpio.h"
+#include "m2mb_hwTmr.h"
+
+#include "azx_log.h"
+#include "azx_metrics.h"
+#include "azx_utils.h"
+#include "azx_reactor.h"
+
+#include "audio_svc.h"
+#include "gpio_input.h"
+
+/* Local defines ================================================================================*/
+/* Local typedefs ===============================================================================*/
+typedef struct
+{
+  UINT8 gpio;
+  INT32 fd;
+  CHAR file[AUDIO_SVC_FILE_LEN];
+  M2MB_HWTMR_HANDLE tmr;
+  volatile UINT32 edge_ms;   /* first edge of the current press */
+  volatile BOOLEAN pending;  /* debounce timer running */
+} GPIO_INPUT_T;
+
+/* Local statics ================================================================================*/
+static GPIO_INPUT_T inputs[GPIO_INPUT_MAX];
+static UINT32 input_count = 0;
+static AZX_METRIC_T *presses;
+static AZX_METRIC_T *bounces;
+static INT32 input_src = -1;
+
+/* Local function prototypes ====================================================================*/
+static UINT32 now_ms(void);
+static void gpio_input_isr(UINT32 fd, void *userdata);
+static void gpio_input_debounced(M2MB_HWTMR_HANDLE handle, void *arg);
+static void gpio_input_handler(UINT32 index, void *ctx);
+
+/* Static functions =============================================================================*/
+static UINT32 now_ms(void)
+{
+  return (UINT32)azx_clock_ms();
+}
+
+static void gpio_input_isr(UINT32 fd, void *userdata)
+{
+  GPIO_INPUT_T *in = (GPIO_INPUT_T *)userdata;
+  (void)fd;
+
+  if(in->pending)
+  {
+    /* Contact bounce: wait again for the pin to settle */
+    AZX_METRICS_INC(bounces);
+    m2mb_hwTmr_stop(in->tmr);
+  }
+  else
+  {
+    in->edge_ms = now_ms();
+    in->pending = TRUE;
+  }
+  m2mb_hwTmr_start(in->tmr);
+}
+
+static void gpio_input_debounced(M2MB_HWTMR_HANDLE handle, void *arg)
+{
+  GPIO_INPUT_T *in = (GPIO_INPUT_T *)arg;
+  (void)handle;
+
+  in->pending = FALSE;
+  azx_reactor_post(input_src, (UINT32)(in - inputs));
+}
+
+static void gpio_input_handler(UINT32 index, void *ctx)
+{
+  GPIO_INPUT_T *in = &inputs[index];
+  M2MB_GPIO_VALUE_E level = M2MB_GPIO_HIGH_VALUE;
+  (void)ctx;
+
+  if(m2mb_gpio_read(in->fd, &level) == 0 && level == M2MB_GPIO_LOW_VALUE)
+  {
+    AZX_METRICS_INC(presses);
+    audio_svc_trigger(in->file, in->edge_ms);
+  }
+}
+
+/* Global functions =============================================================================*/
+BOOLEAN gpio_input_add(UINT8 gpio, const CHAR *file)
+{
+  M2MB_HWTMR_ATTR_HANDLE tmrAttrHandle;
+  GPIO_INPUT_T *in;
+  CHAR path[16];
+
+  if(input_count >= GPIO_INPUT_MAX)
+  {
+    AZX_LOG_ERROR("No room for input GPIO%u\r\n", gpio);
+    return FALSE;
+  }
+  if(!presses)
+  {
+    presses = azx_metrics_register("input.presses", AZX_METRIC_COUNTER);
+    bounces = azx_metrics_register("input.bounces", AZX_METRIC_COUNTER);
+  }
+  if(input_src < 0)
+  {
+    input_src = azx_reactor_add("gpio_input", gpio_input_handler, NULL);
+    if(input_src < 0)
+    {
+      return FALSE;
+    }
+  }
+  in = &inputs[input_count];
+  memset(in, 0, sizeof(*in));
+  in->gpio = gpio;
+  strncpy(in->file, file, sizeof(in->file) - 1);
+
+  if(m2mb_hwTmr_setAttrItem(&tmrAttrHandle, 1, M2MB_HWTMR_SEL_CMD_CREATE_ATTR, NULL) != M2MB_HWTMR_SUCCESS ||
+      m2mb_hwTmr_setAttrItem(&tmrAttrHandle, CMDS_ARGS(
+          M2MB_HWTMR_SEL_CMD_CB_FUNC, &gpio_input_debounced,
+          M2MB_HWTMR_SEL_CMD_ARG_CB, in,
+          M2MB_HWTMR_SEL_CMD_TIME_DURATION, GPIO_INPUT_DEBOUNCE_US,
+          M2MB_HWTMR_SEL_CMD_PERIODIC, M2MB_HWTMR_ONESHOT_TMR,
+          M2MB_HWTMR_SEL_CMD_AUTOSTART, M2MB_HWTMR_NOT_START)) != M2MB_HWTMR_SUCCESS ||
+      m2mb_hwTmr_init(&in->tmr, &tmrAttrHandle) != M2MB_HWTMR_SUCCESS)
+  {
+    AZX_LOG_ERROR("Cannot create debounce timer for GPIO%u\r\n", gpio);
+    return FALSE;
+  }
+
+  snprintf(path, sizeof(path), "/dev/GPIO%u", gpio);
+  in->fd = m2mb_gpio_open(path, 0);
+  if(in->fd == -1)
+  {
+    AZX_LOG_ERROR("Cannot open %s\r\n", path);
+    m2mb_hwTmr_deinit(in->tmr);
+    return FALSE;
+  }
+  /* M2MB_GPIO_IOCTL_INIT_INTR must be the last ioctl */
+  if(m2mb_gpio_multi_ioctl(in->fd, CMDS_ARGS(
+      M2MB_GPIO_IOCTL_SET_DIR, M2MB_GPIO_MODE_INPUT,
+      M2MB_GPIO_IOCTL_SET_PULL, M2MB_GPIO_PULL_UP,
+      M2MB_GPIO_IOCTL_SET_INTR_TYPE, INTR_CB_SET,
+      M2MB_GPIO_IOCTL_SET_INTR_CB, (UINT32)gpio_input_isr,
+      M2MB_GPIO_IOCTL_SET_INTR_ARG, (UINT32)in,
+      M2MB_GPIO_IOCTL_SET_INTR_TRIGGER, M2MB_GPIO_INTR_NEGEDGE,
+      M2MB_GPIO_IOCTL_INIT_INTR, NULL)) == -1)
+  {
+    AZX_LOG_ERROR("Cannot configure %s interrupt\r\n", path);
+    m2mb_gpio_close(in->fd);
+    m2mb_hwTmr_deinit(in->tmr);
+    return FALSE;
+  }
+  input_count++;
+  AZX_LOG_INFO("GPIO%u plays %s\r\n", gpio, file);
+  return TRUE;
+}
@@ -0,0 +1,485 @@
+/**
+  @file
+    i2c_bus.c
+
+  @brief
+    I2C bus transaction scheduler
+
+  @details
+    Callers own a transaction slot while it is in flight: the slot index goes
+    through the priority queue to the scheduler task, which sets the slot's
+    bit in an event group once the transaction is done. The caller's buffers
+    are used in place, nothing is copied or allocated.
+
+  @version
+    1.0.0
+  @note
+
+
+  @date
+    19/10/2026
+*/
+/* Include files ================================================================================*/
+
+#include <stdio.h>
+#include <string.h>
+#include "m2mb_types.h"
+#include "m2mb_os_api.h"
+#ifndef I2C_BUS_M2MB
+#include <linux/i2c-dev.h>
+#include <linux/i2c.h>
+#include <sys/ioctl.h>
+#include <sys/types.h>
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#include "m2mb_i2c.h"
+#endif
+
+#include "azx_log.h"
+#include "azx_trace.h"
+#include "azx_metrics.h"
+#include "azx_utils.h"
+
+#include "i2c_bus.h"
+
+/* Local defines ================================================================================*/
+#define I2C_BUS_STACK_SIZE 4096
+#define I2C_BUS_PRIORITY   198  /* above every bus user */
+
+#define I2C_BUS_ALL_SLOTS  ((UINT32)((1ULL << I2C_BUS_SLOTS) - 1))
+
+/* Local typedefs ===============================================================================*/
+typedef struct
+{
+  const CHAR *name;
+  UINT8 addr;
+  I2C_BUS_PRIO_E prio;
+  INT32 fd;
+  volatile BOOLEAN reset_req;
+  AZX_METRIC_T *bus_us;
+  AZX_METRIC_T *queue_us;
+  CHAR bus_name[24];
+  CHAR queue_name[24];
+} I2C_BUS_DEV_T;
+
+typedef struct
+{
+  INT32 dev;
+  const UINT8 *wr;
+  UINT16 wlen;
+  UINT8 *rd;
+  UINT16 rlen;
+  UINT64 enq_us;
+  BOOLEAN ok;
+} I2C_BUS_REQ_T;
+
+/* Local statics ================================================================================*/
+static M2MB_OS_TASK_HANDLE bus_task = NULL;
+static M2MB_OS_Q_HANDLE bus_q[I2C_BUS_PRIO_MAX];
+static UINT32 bus_q_area[I2C_BUS_PRIO_MAX][I2C_BUS_SLOTS];
+static M2MB_OS_SEM_HANDLE work_sem = NULL;   /* one count per queued transaction */
+static M2MB_OS_SEM_HANDLE slot_sem = NULL;   /* one count per free slot */
+static M2MB_OS_EV_HANDLE done_ev = NULL;     /* one bit per completed slot */
+
+static I2C_BUS_DEV_T devs[I2C_BUS_MAX_DEVS];
+static volatile UINT32 dev_count = 0;
+static I2C_BUS_REQ_T slots[I2C_BUS_SLOTS];
+static volatile UINT32 slot_free = I2C_BUS_ALL_SLOTS;
+static UINT64 init_us;
+
+#ifndef I2C_BUS_M2MB
+static int bus_fd = -1;
+static INT32 bus_addr = -1;
+#endif
+
+/* Local function prototypes ====================================================================*/
+static M2MB_OS_SEM_HANDLE sem_create(const CHAR *name, UINT32 count);
+static BOOLEAN dev_open(I2C_BUS_DEV_T *d);
+static void dev_close(I2C_BUS_DEV_T *d);
+static BOOLEAN dev_xfer(I2C_BUS_DEV_T *d, I2C_BUS_REQ_T *r);
+static UINT32 bus_pop(void);
+static void bus_task_fn(void *arg);
+
+/* Static functions =============================================================================*/
+static M2MB_OS_SEM_HANDLE sem_create(const CHAR *name, UINT32 count)
+{
+  M2MB_OS_SEM_ATTR_HANDLE semAttrHandle;
+  M2MB_OS_SEM_HANDLE sem = NULL;
+
+  m2mb_os_sem_setAttrItem(&semAttrHandle, CMDS_ARGS(M2MB_OS_SEM_SEL_CMD_CREATE_ATTR, NULL,
+      M2MB_OS_SEM_SEL_CMD_COUNT, count, M2MB_OS_SEM_SEL_CMD_TYPE, M2MB_OS_SEM_COUNTING,
+      M2MB_OS_SEM_SEL_CMD_NAME, name));
+  if(m2mb_os_sem_init(&sem, &semAttrHandle) != M2MB_OS_SUCCESS)
+  {
+    m2mb_os_sem_setAttrItem(&semAttrHandle, 1, M2MB_OS_SEM_SEL_CMD_DEL_ATTR, NULL);
+    return NULL;
+  }
+  return sem;
+}
+
+#ifndef I2C_BUS_M2MB
+static BOOLEAN dev_open(I2C_BUS_DEV_T *d)
+{
+  if(bus_fd < 0)
+  {
+    // Open a connection to the I2C userspace control file.
+    if((bus_fd = open(I2C_BUS_DEV, O_RDWR)) < 0)
+    {
+      AZX_LOG_ERROR("[I2C] Unable to open %s control file\r\n", I2C_BUS_DEV);
+      return FALSE;
+    }
+    bus_addr = -1;
+  }
+  /* Only switch the slave address when the device changes */
+  if(bus_addr != d->addr)
+  {
+    if(ioctl(bus_fd, I2C_SLAVE, d->addr) < 0)
+    {
+      AZX_LOG_ERROR("[I2C] Unable to set slave addr 0x%02X\r\n", d->addr);
+      return FALSE;
+    }
+    bus_addr = d->addr;
+  }
+  d->fd = bus_fd;
+  return TRUE;
+}
+
+static void dev_close(I2C_BUS_DEV_T *d)
+{
+  /* The session is shared: close it for everybody, it is cheap to reopen */
+  if(bus_fd >= 0)
+  {
+    close(bus_fd);
+    bus_fd = -1;
+  }
+  d->fd = -1;
+}
+
+static BOOLEAN dev_xfer(I2C_BUS_DEV_T *d, I2C_BUS_REQ_T *r)
+{
+  struct i2c_msg msgs[2];
+  struct i2c_rdwr_ioctl_data data;
+
+  if(r->rlen == 0)
+  {
+    return write(bus_fd, r->wr, r->wlen) == r->wlen;
+  }
+  msgs[0].addr = d->addr;
+  msgs[0].flags = 0;
+  msgs[0].len = r->wlen;
+  msgs[0].buf = (UINT8 *)r->wr;
+  msgs[1].addr = d->addr;
+  msgs[1].flags = I2C_M_RD;
+  msgs[1].len = r->rlen;
+  msgs[1].buf = r->rd;
+  data.msgs = msgs;
+  data.nmsgs = 2;
+  return ioctl(bus_fd, I2C_RDWR, &data) == 2;
+}
+
+#else
+static BOOLEAN dev_open(I2C_BUS_DEV_T *d)
+{
+  M2MB_I2C_CFG_T cfg;
+  CHAR path[16];
+
+  if(d->fd != -1)
+  {
+    return TRUE;
+  }
+  /* m2mb_i2c takes the 8 bit device address, in decimal */
+  snprintf(path, sizeof(path), "/dev/I2C-%d", d->addr << 1);
+  if((d->fd = m2mb_i2c_open(path, 0)) == -1)
+  {
+    AZX_LOG_ERROR("[I2C] Unable to open %s\r\n", path);
+    return FALSE;
+  }
+  memset(&cfg, 0, sizeof(cfg));
+  cfg.sdaPin = I2C_BUS_SDA_PIN;
+  cfg.sclPin = I2C_BUS_SCL_PIN;
+  if(m2mb_i2c_ioctl(d->fd, M2MB_I2C_IOCTL_SET_CFG, (void *)&cfg) != 0)
+  {
+    AZX_LOG_ERROR("[I2C] Unable to configure %s\r\n", path);
+    dev_close(d);
+    return FALSE;
+  }
+  return TRUE;
+}
+
+static void dev_close(I2C_BUS_DEV_T *d)
+{
+  if(d->fd != -1)
+  {
+    m2mb_i2c_close(d->fd);
+    d->fd = -1;
+  }
+}
+
+static BOOLEAN dev_xfer(I2C_BUS_DEV_T *d, I2C_BUS_REQ_T *r)
+{
+  M2MB_I2C_MSG msgs[2];
+  M2MB_I2C_RDWR_IOCTL_DATA data;
+  M2MB_I2C_CFG_T cfg;
+  INT32 res;
+
+  memset(&cfg, 0, sizeof(cfg));
+  cfg.sdaPin = I2C_BUS_SDA_PIN;
+  cfg.sclPin = I2C_BUS_SCL_PIN;
+  cfg.registerId = r->wr[0];
+  cfg.rw_param = &data;
+  msgs[0].flags = I2C_M_WR;
+  msgs[0].len = r->wlen;
+  msgs[0].buf = (UINT8 *)r->wr;
+  msgs[1].flags = I2C_M_RD;
+  msgs[1].len = r->rlen;
+  msgs[1].buf = r->rd;
+  data.msgs = msgs;
+  data.nmsgs = r->rlen ? 2 : 1;
+  res = m2mb_i2c_ioctl(d->fd, M2MB_I2C_IOCTL_RDWR, (void *)&cfg);
+  return res == (r->rlen ? r->rlen : r->wlen);
+}
+#endif
+
+/*-----------------------------------------------------------------------------------------------*/
+/*!
+  \brief Takes the next queued slot, highest priority class first
+
+  Must only be called after taking one count of work_sem, which guarantees
+  that a slot is queued.
+ */
+/*-----------------------------------------------------------------------------------------------*/
+static UINT32 bus_pop(void)
+{
+  UINT32 idx;
+  int p;
+
+  for(;;)
+  {
+    for(p = 0; p < I2C_BUS_PRIO_MAX; p++)
+    {
+      if(m2mb_os_q_rx(bus_q[p], &idx, M2MB_OS_NO_WAIT) == M2MB_OS_SUCCESS)
+      {
+        return idx;
+      }
+    }
+  }
+}
+
+static void bus_task_fn(void *arg)
+{
+  UINT32 batch[I2C_BUS_BATCH];
+  UINT32 n, i, j;
+  (void)arg;
+
+  for(;;)
+  {
+    m2mb_os_sem_get(work_sem, M2MB_OS_WAIT_FOREVER);
+    n = 0;
+    batch[n++] = bus_pop();
+    while(n < I2C_BUS_BATCH && m2mb_os_sem_get(work_sem, M2MB_OS_NO_WAIT) == M2MB_OS_SUCCESS)
+    {
+      batch[n++] = bus_pop();
+    }
+
+    /* Stable sort by priority, then address: a device's transactions stay in order */
+    for(i = 1; i < n; i++)
+    {
+      UINT32 idx = batch[i];
+      I2C_BUS_DEV_T *d = &devs[slots[idx].dev];
+      for(j = i; j > 0; j--)
+      {
+        I2C_BUS_DEV_T *o = &devs[slots[batch[j - 1]].dev];
+        if(o->prio < d->prio || (o->prio == d->prio && o->addr <= d->addr))
+        {
+          break;
+        }
+        batch[j] = batch[j - 1];
+      }
+      batch[j] = idx;
+    }
+
+    for(i = 0; i < n; i++)
+    {
+      I2C_BUS_REQ_T *r = &slots[batch[i]];
+      I2C_BUS_DEV_T *d = &devs[r->dev];
+      UINT64 start = azx_clock_us();
+
+      if(d->reset_req)
+      {
+        d->reset_req = FALSE;
+        dev_close(d);
+      }
+      AZX_TRACE_BEGIN_EVT("i2c_xfer");
+      r->ok = dev_open(d) && dev_xfer(d, r);
+      AZX_TRACE_END_EVT("i2c_xfer");
+      if(!r->ok)
+      {
+        /* Reopen on next access, the session may be stale */
+        dev_close(d);
+      }
+      azx_metrics_observe(d->queue_us, (UINT32)(start - r->enq_us));
+      azx_metrics_add(d->bus_us, azx_elapsed_us(start));
+      m2mb_os_ev_set(done_ev, 1U << batch[i], M2MB_OS_EV_SET);
+    }
+  }
+}
+
+/* Global functions =============================================================================*/
+BOOLEAN i2c_bus_init(void)
+{
+  M2MB_OS_Q_ATTR_HANDLE qAttrHandle;
+  M2MB_OS_EV_ATTR_HANDLE evAttrHandle;
+  M2MB_OS_TASK_ATTR_HANDLE taskAttrHandle;
+  M2MB_OS_TASK_HANDLE task = NULL;
+  int p;
+
+  if(bus_task)
+  {
+    return TRUE;
+  }
+  init_us = azx_clock_us();
+  for(p = 0; p < I2C_BUS_PRIO_MAX; p++)
+  {
+    if(m2mb_os_q_setAttrItem(&qAttrHandle, CMDS_ARGS(
+        M2MB_OS_Q_SEL_CMD_CREATE_ATTR, NULL,
+        M2MB_OS_Q_SEL_CMD_NAME, "I2CQ",
+        M2MB_OS_Q_SEL_CMD_QSTART, bus_q_area[p],
+        M2MB_OS_Q_SEL_CMD_MSG_SIZE, WORD32_FOR_MSG(UINT32),
+        M2MB_OS_Q_SEL_CMD_QSIZE, sizeof(bus_q_area[p]))) != M2MB_OS_SUCCESS ||
+        m2mb_os_q_init(&bus_q[p], &qAttrHandle) != M2MB_OS_SUCCESS)
+    {
+      AZX_LOG_ERROR("Cannot create I2C queue\r\n");
+      return FALSE;
+    }
+  }
+  work_sem = sem_create("I2CWork", 0);
+  slot_sem = sem_create("I2CSlot", I2C_BUS_SLOTS);
+  if(!work_sem || !slot_sem)
+  {
+    AZX_LOG_ERROR("Cannot create I2C semaphores\r\n");
+    return FALSE;
+  }
+  if(m2mb_os_ev_setAttrItem(&evAttrHandle, CMDS_ARGS(
+      M2MB_OS_EV_SEL_CMD_CREATE_ATTR, NULL,
+      M2MB_OS_EV_SEL_CMD_NAME, "I2CDone")) != M2MB_OS_SUCCESS ||
+      m2mb_os_ev_init(&done_ev, &evAttrHandle) != M2MB_OS_SUCCESS)
+  {
+    AZX_LOG_ERROR("Cannot create I2C event group\r\n");
+    return FALSE;
+  }
+
+  m2mb_os_taskSetAttrItem(&taskAttrHandle, CMDS_ARGS(
+      M2MB_OS_TASK_SEL_CMD_CREATE_ATTR, NULL,
+      M2MB_OS_TASK_SEL_CMD_STACK_SIZE, I2C_BUS_STACK_SIZE,
+      M2MB_OS_TASK_SEL_CMD_NAME, "I2CBus",
+      M2MB_OS_TASK_SEL_CMD_PRIORITY, I2C_BUS_PRIORITY,
+      M2MB_OS_TASK_SEL_CMD_PREEMPTIONTH, I2C_BUS_PRIORITY,
+      M2MB_OS_TASK_SEL_CMD_AUTOSTART, M2MB_OS_TASK_AUTOSTART));
+  if(m2mb_os_taskCreate(&task, &taskAttrHandle, bus_task_fn, NULL) != M2MB_OS_SUCCESS)
+  {
+    m2mb_os_taskSetAttrItem(&taskAttrHandle, 1, M2MB_OS_TASK_SEL_CMD_DEL_ATTR, NULL);
+    AZX_LOG_ERROR("Cannot create I2C bus task\r\n");
+    return FALSE;
+  }
+  bus_task = task;
+  return TRUE;
+}
+
+INT32 i2c_bus_register(const CHAR *name, UINT8 addr, I2C_BUS_PRIO_E prio)
+{
+  I2C_BUS_DEV_T *d;
+  UINT32 i;
+
+  for(i = 0; i < dev_count; i++)
+  {
+    if(devs[i].name && strcmp(devs[i].name, name) == 0)
+    {
+      return (INT32)i;
+    }
+  }
+  i = __sync_fetch_and_add(&dev_count, 1);
+  if(i >= I2C_BUS_MAX_DEVS)
+  {
+    __sync_fetch_and_sub(&dev_count, 1);
+    AZX_LOG_ERROR("I2C device table full, %s dropped\r\n", name);
+    return -1;
+  }
+  d = &devs[i];
+  d->addr = addr;
+  d->prio = (prio < I2C_BUS_PRIO_MAX) ? prio : I2C_BUS_PRIO_SENSOR;
+  d->fd = -1;
+  d->reset_req = FALSE;
+  snprintf(d->bus_name, sizeof(d->bus_name), "%s.bus_us", name);
+  snprintf(d->queue_name, sizeof(d->queue_name), "%s.queue_us", name);
+  d->bus_us = azx_metrics_register(d->bus_name, AZX_METRIC_COUNTER);
+  d->queue_us = azx_metrics_register(d->queue_name, AZX_METRIC_HISTOGRAM);
+  d->name = name;
+  return (INT32)i;
+}
+
+BOOLEAN i2c_bus_xfer(INT32 dev, const UINT8 *wr, UINT16 wlen, UINT8 *rd, UINT16 rlen)
+{
+  I2C_BUS_REQ_T *r;
+  UINT32 idx, free_mask, cur;
+
+  if(!bus_task || dev < 0 || (UINT32)dev >= dev_count || !wr || wlen == 0 || (rlen && !rd))
+  {
+    return FALSE;
+  }
+
+  /* The semaphore guarantees a free bit, the CAS picks it */
+  m2mb_os_sem_get(slot_sem, M2MB_OS_WAIT_FOREVER);
+  do
+  {
+    free_mask = slot_free;
+    idx = __builtin_ctz(free_mask);
+  } while(!__sync_bool_compare_and_swap(&slot_free, free_mask, free_mask & ~(1U << idx)));
+
+  r = &slots[idx];
+  r->dev = dev;
+  r->wr = wr;
+  r->wlen = wlen;
+  r->rd = rd;
+  r->rlen = rlen;
+  r->ok = FALSE;
+  r->enq_us = azx_clock_us();
+  m2mb_os_q_tx(bus_q[devs[dev].prio], &idx, M2MB_OS_NO_WAIT, 0);
+  m2mb_os_sem_put(work_sem);
+
+  m2mb_os_ev_get(done_ev, 1U << idx, M2MB_OS_EV_GET_ANY_AND_CLEAR, &cur, M2MB_OS_WAIT_FOREVER);
+
+  cur = r->ok;
+  __sync_fetch_and_or(&slot_free, 1U << idx);
+  m2mb_os_sem_put(slot_sem);
+  return (BOOLEAN)cur;
+}
+
+void i2c_bus_reset(INT32 dev)
+{
+  if(dev >= 0 && (UINT32)dev < dev_count)
+  {
+    devs[dev].reset_req = TRUE;
+  }
+}
+
+void i2c_bus_log_stats(void)
+{
+  UINT64 elapsed = azx_clock_us() - init_us;
+  UINT32 i;
+
+  if(elapsed == 0)
+  {
+    elapsed = 1;
+  }
+  for(i = 0; i < dev_count && i < I2C_BUS_MAX_DEVS; i++)
+  {
+    I2C_BUS_DEV_T *d = &devs[i];
+    UINT32 busy = d->bus_us ? d->bus_us->value : 0;
+    UINT32 waits = d->queue_us ? d->queue_us->value : 0;
+    AZX_LOG_INFO("[I2C] %s @0x%02X: bus %u us (%u.%u%%), %u transactions, queue avg %u us max %u us\r\n",
+        d->name, d->addr, busy, (UINT32)(busy * 100ULL / elapsed),
+        (UINT32)(busy * 1000ULL / elapsed % 10), waits,
+        waits ? d->queue_us->sum / waits : 0, waits ? d->queue_us->max : 0);
+  }
+}
@@ -0,0 +1,301 @@
+/**
+  @file
+    modem_state.c
+
+  @brief
+    Model of the modem settings managed by the application
+
+  @details
+    Each setting has an optional query, batched with the others into one
+    command line, the prefix of its value in the query response and the
+    format of its set command. Skipped commands are counted in the
+    modem.at_skipped metric.
+
+    The snapshot file is a header (magic, version, configuration hash)
+    followed by one record per persistent setting.
+
+  @version
+    1.0.0
+  @note
+
+
+  @date
+    19/10/2026
+*/
+/* Include files ================================================================================*/
+
+#include <stdio.h>
+#include <string.h>
+#include "m2mb_types.h"
+#include "m2mb_fs_stdio.h"
+
+#include "azx_log.h"
+#include "azx_metrics.h"
+
+#include "at_utils.h"
+#include "modem_state.h"
+
+/* Local defines ================================================================================*/
+#define MODEM_STATE_CMD_LEN   32
+#define MODEM_STATE_QUERY_LEN 64
+
+#define MODEM_STATE_MAGIC   0x5453534D /* "MSST" */
+#define MODEM_STATE_VERSION 1
+
+/* Local typedefs ===============================================================================*/
+typedef struct
+{
+  const CHAR *name;
+  const CHAR *query;     /* read command without the AT prefix, NULL if none */
+  const CHAR *prefix;    /* value prefix in the query response */
+  const CHAR *set_fmt;   /* set command, %s is the value */
+  BOOLEAN mandatory;     /* sent even if the value is known */
+  BOOLEAN persistent;    /* kept by the modem across power cycles */
+  BOOLEAN known;
+  CHAR value[MODEM_STATE_VALUE_LEN];
+  CHAR pending[MODEM_STATE_VALUE_LEN];
+  CHAR cmd[MODEM_STATE_CMD_LEN];
+} MODEM_SETTING_T;
+
+typedef struct
+{
+  UINT32 magic;
+  UINT16 version;
+  UINT16 count;
+  UINT32 cfg_hash;
+} MODEM_STATE_FILE_HDR_T;
+
+typedef struct
+{
+  UINT8 setting;
+  UINT8 known;
+  CHAR value[MODEM_STATE_VALUE_LEN];
+} MODEM_STATE_FILE_REC_T;
+
+/* Local statics ================================================================================*/
+static MODEM_SETTING_T settings[MODEM_STATE_MAX] =
+{
+  { "GPSP", "$GPSP?",    "$GPSP: ", "AT$GPSP=%s\r",   FALSE, TRUE,  FALSE, "", "", "" },
+  { "VAUX", "#VAUX=1,2", "#VAUX: ", "AT#VAUX=1,%s\r", FALSE, FALSE, FALSE, "", "", "" },
+  { "ECHO", NULL,        NULL,      "ATE%s\r",        FALSE, FALSE, FALSE, "", "", "" },
+  { "DVI",  NULL,        NULL,      "AT#DVI=%s\r",    TRUE,  FALSE, FALSE, "", "", "" },
+};
+
+static CHAR query[MODEM_STATE_QUERY_LEN];
+static CHAR rsp[64];
+static AZX_METRIC_T *skipped;
+
+/* Local function prototypes ====================================================================*/
+/* Static functions =============================================================================*/
+/* Global functions =============================================================================*/
+const CHAR *modem_state_query(void)
+{
+  UINT32 i, len;
+
+  if(query[0] == '\0')
+  {
+    len = snprintf(query, sizeof(query), "AT");
+    for(i = 0; i < MODEM_STATE_MAX; i++)
+    {
+      if(settings[i].query)
+      {
+        len += snprintf(query + len, sizeof(query) - len, "%s%s",
+            (len > 2) ? ";" : "", settings[i].query);
+      }
+    }
+    snprintf(query + len, sizeof(query) - len, "\r");
+  }
+  return query;
+}
+
+void modem_state_parse(const CHAR *response)
+{
+  UINT32 i, n;
+  BOOLEAN found = FALSE;
+
+  for(i = 0; i < MODEM_STATE_MAX; i++)
+  {
+    MODEM_SETTING_T *s = &settings[i];
+    const CHAR *p;
+
+    if(!s->prefix || (p = strstr(response, s->prefix)) == NULL)
+    {
+      continue;
+    }
+    p += strlen(s->prefix);
+    for(n = 0; n < sizeof(s->value) - 1 && p[n] && p[n] != '\r' && p[n] != '\n'; n++)
+    {
+      s->value[n] = p[n];
+    }
+    s->value[n] = '\0';
+    s->known = TRUE;
+    found = TRUE;
+    AZX_LOG_DEBUG("Modem %s is %s\r\n", s->name, s->value);
+  }
+
+  /* With echo on, the response starts with the query itself */
+  if(found)
+  {
+    strcpy(settings[MODEM_STATE_ECHO].value,
+        strstr(response, settings[MODEM_STATE_GPSP].query) ? "1" : "0");
+    settings[MODEM_STATE_ECHO].known = TRUE;
+  }
+}
+
+const CHAR *modem_state_cmd(MODEM_STATE_E setting, const CHAR *value)
+{
+  MODEM_SETTING_T *s;
+
+  if(setting >= MODEM_STATE_MAX || !value)
+  {
+    return NULL;
+  }
+  s = &settings[setting];
+  if(!s->mandatory && s->known && strcmp(s->value, value) == 0)
+  {
+    if(!skipped)
+    {
+      skipped = azx_metrics_register("modem.at_skipped", AZX_METRIC_COUNTER);
+    }
+    AZX_METRICS_INC(skipped);
+    AZX_LOG_DEBUG("Modem %s already %s, command skipped\r\n", s->name, value);
+    return NULL;
+  }
+  snprintf(s->pending, sizeof(s->pending), "%s", value);
+  snprintf(s->cmd, sizeof(s->cmd), s->set_fmt, value);
+  return s->cmd;
+}
+
+void modem_state_done(MODEM_STATE_E setting, BOOLEAN ok)
+{
+  MODEM_SETTING_T *s;
+
+  if(setting >= MODEM_STATE_MAX)
+  {
+    return;
+  }
+  s = &settings[setting];
+  if(ok)
+  {
+    memcpy(s->value, s->pending, sizeof(s->value));
+  }
+  s->known = ok;
+}
+
+BOOLEAN modem_state_set(INT16 instance, MODEM_STATE_E setting, const CHAR *value, BOOLEAN *sent)
+{
+  const CHAR *cmd = modem_state_cmd(setting, value);
+  BOOLEAN ok;
+
+  if(sent)
+  {
+    *sent = (cmd != NULL);
+  }
+  if(!cmd)
+  {
+    return setting < MODEM_STATE_MAX;
+  }
+  ok = send_async_at_command(instance, cmd, rsp, sizeof(rsp)) == M2MB_RESULT_SUCCESS &&
+      strstr(rsp, "OK") != NULL;
+  if(!ok)
+  {
+    AZX_LOG_ERROR("Error sending command <%s>\r\n", cmd);
+  }
+  modem_state_done(setting, ok);
+  return ok;
+}
+
+void modem_state_invalidate(MODEM_STATE_E setting)
+{
+  UINT32 i;
+
+  for(i = 0; i < MODEM_STATE_MAX; i++)
+  {
+    if(setting == MODEM_STATE_MAX || setting == i)
+    {
+      settings[i].known = FALSE;
+    }
+  }
+}
+
+UINT32 modem_state_hash(const CHAR *cfg)
+{
+  UINT32 h = 2166136261U ^ MODEM_STATE_VERSION;  /* FNV-1a */
+
+  while(cfg && *cfg)
+  {
+    h = (h ^ (UINT8)*cfg++) * 16777619U;
+  }
+  return h;
+}
+
+BOOLEAN modem_state_load(UINT32 cfg_hash)
+{
+  MODEM_STATE_FILE_HDR_T hdr;
+  MODEM_STATE_FILE_REC_T rec;
+  M2MB_FILE_T *fd = m2mb_fs_fopen(MODEM_STATE_SNAPSHOT_FILE, "rb");
+  BOOLEAN ok = FALSE;
+  UINT32 i;
+
+  if(!fd)
+  {
+    return FALSE;
+  }
+  if(m2mb_fs_fread(&hdr, sizeof(hdr), 1, fd) == 1 && hdr.magic == MODEM_STATE_MAGIC &&
+      hdr.version == MODEM_STATE_VERSION && hdr.cfg_hash == cfg_hash)
+  {
+    ok = TRUE;
+    for(i = 0; i < hdr.count && ok; i++)
+    {
+      ok = (m2mb_fs_fread(&rec, sizeof(rec), 1, fd) == 1);
+      if(ok && rec.setting < MODEM_STATE_MAX && settings[rec.setting].persistent)
+      {
+        memcpy(settings[rec.setting].value, rec.value, sizeof(rec.value));
+        settings[rec.setting].value[sizeof(rec.value) - 1] = '\0';
+        settings[rec.setting].known = rec.known;
+      }
+    }
+  }
+  m2mb_fs_fclose(fd);
+  AZX_LOG_DEBUG("Modem state snapshot %s\r\n", ok ? "restored" : "stale");
+  return ok;
+}
+
+BOOLEAN modem_state_save(UINT32 cfg_hash)
+{
+  MODEM_STATE_FILE_HDR_T hdr;
+  MODEM_STATE_FILE_REC_T rec;
+  M2MB_FILE_T *fd;
+  BOOLEAN written;
+  UINT32 i;
+
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.magic = MODEM_STATE_MAGIC;
+  hdr.version = MODEM_STATE_VERSION;
+  hdr.cfg_hash = cfg_hash;
+  for(i = 0; i < MODEM_STATE_MAX; i++)
+  {
+    hdr.count += settings[i].persistent ? 1 : 0;
+  }
+
+  fd = m2mb_fs_fopen(MODEM_STATE_SNAPSHOT_FILE, "wb");
+  if(!fd)
+  {
+    AZX_LOG_ERROR("Cannot open %s\r\n", MODEM_STATE_SNAPSHOT_FILE);
+    return FALSE;
+  }
+  written = (m2mb_fs_fwrite(&hdr, sizeof(hdr), 1, fd) == 1);
+  for(i = 0; i < MODEM_STATE_MAX && written; i++)
+  {
+    if(settings[i].persistent)
+    {
+      memset(&rec, 0, sizeof(rec));
+      rec.setting = (UINT8)i;
+      rec.known = settings[i].known;
+      memcpy(rec.value, settings[i].value, sizeof(rec.value));
+      written = (m2mb_fs_fwrite(&rec, sizeof(rec), 1, fd) == 1);
+    }
+  }
+  m2mb_fs_fclose(fd);
+  return written;
+}
@@ -0,0 +1,141 @@
+/**
+  @file
+    playlist.c
+
+  @brief
+    Playlist of audio clips for the audio service
+
+  @details
+    A clip is dropped only if its file is found empty in AUDIO_FILES_DIR. The
+    check is a local file system stat, so it costs no modem traffic; a file
+    that cannot be stat'ed may still be known to AT#APLAY, which decides.
+
+  @version
+    1.0.0
+  @note
+
+
+  @date
+    19/10/2026
+*/
+/* Include files ================================================================================*/
+
+#include <stdio.h>
+#include <string.h>
+#include "m2mb_types.h"
+#include "m2mb_fs_posix.h"
+
+#include "azx_log.h"
+
+#include "app_cfg.h"
+#include "playlist.h"
+
+/* Local defines ================================================================================*/
+/* Local typedefs ===============================================================================*/
+typedef enum
+{
+  CLIP_UNCHECKED,
+  CLIP_VALID,
+  CLIP_INVALID
+} CLIP_STATE_E;
+
+typedef struct
+{
+  CHAR file[AUDIO_SVC_FILE_LEN];
+  CLIP_STATE_E state;
+} CLIP_T;
+
+/* Local statics ================================================================================*/
+static CLIP_T clips[PLAYLIST_LEN];
+static UINT32 head = 0;
+static UINT32 count = 0;
+
+/* Local function prototypes ====================================================================*/
+static CLIP_STATE_E validate(const CHAR *file);
+
+/* Static functions =============================================================================*/
+static CLIP_STATE_E validate(const CHAR *file)
+{
+  CHAR path[64];
+  struct M2MB_STAT st;
+
+  snprintf(path, sizeof(path), "%s/%s", AUDIO_FILES_DIR, file);
+  if(m2mb_fs_stat(path, &st) == -1)
+  {
+    /* Unknown: AT#APLAY may look elsewhere, let it fail the clip */
+    AZX_LOG_DEBUG("Audio file %s not found locally\r\n", path);
+    return CLIP_VALID;
+  }
+  if(st.st_size == 0)
+  {
+    AZX_LOG_WARN("Audio file %s is empty, skipping it\r\n", path);
+    return CLIP_INVALID;
+  }
+  return CLIP_VALID;
+}
+
+/* Global functions =============================================================================*/
+BOOLEAN playlist_push(const CHAR *file)
+{
+  CLIP_T *clip;
+
+  if(count == PLAYLIST_LEN)
+  {
+    return FALSE;
+  }
+  clip = &clips[(head + count) % PLAYLIST_LEN];
+  memset(clip, 0, sizeof(*clip));
+  strncpy(clip->file, file, sizeof(clip->file) - 1);
+  clip->state = CLIP_UNCHECKED;
+  count++;
+  return TRUE;
+}
+
+const CHAR* playlist_peek(void)
+{
+  CLIP_T *clip;
+
+  while(count > 0)
+  {
+    clip = &clips[head];
+    if(clip->state == CLIP_UNCHECKED)
+    {
+      clip->state = validate(clip->file);
+    }
+    if(clip->state == CLIP_VALID)
+    {
+      return clip->file;
+    }
+    playlist_pop();
+  }
+  return NULL;
+}
+
+void playlist_pop(void)
+{
+  if(count > 0)
+  {
+    head = (head + 1) % PLAYLIST_LEN;
+    count--;
+  }
+}
+
+void playlist_clear(void)
+{
+  head = 0;
+  count = 0;
+}
+
+void playlist_prefetch(void)
+{
+  CLIP_T *clip;
+
+  if(count > 0)
+  {
+    clip = &clips[head];
+    if(clip->state == CLIP_UNCHECKED)
+    {
+      clip->state = validate(clip->file);
+    }
+  }
+}
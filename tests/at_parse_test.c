@@ -0,0 +1,255 @@
+/**
+  @file
+    at_parse_test.c
+
+  @brief
+    Host checks of the AT response decoders
+
+  @details
+    Built for the host by tests/Makefile, with no modem: at_parse.c only
+    needs the m2mb types. Without arguments the sample responses are
+    checked; "fuzz <n>" feeds n random lines to every decoder (meant to run
+    under the sanitizers) and "bench <n>" times n decodes of each sample.
+
+  @version
+    1.0.0
+  @note
+
+
+  @date
+    19/10/2026
+*/
+/* Include files ================================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "m2mb_types.h"
+
+#include "at_parse.h"
+
+/* Local defines ================================================================================*/
+#define CHECK(c) check((c), #c, __LINE__)
+#define STR_IS(s, lit) ((s).p && (s).len == strlen(lit) && strncmp((s).p, (lit), (s).len) == 0)
+
+#define FUZZ_LINE_MAX 64
+
+/* Local statics ================================================================================*/
+static UINT32 failures = 0;
+
+/* Sample responses, as returned by m2mb_ati_rcv_resp() */
+static const CHAR CSQ_RSP[] = "\r\n+CSQ: 21,99\r\n\r\nOK\r\n";
+static const CHAR GPIO_RSP[] = "AT#GPIO=3,2\r\r\n#GPIO: 1,0\r\n\r\nOK\r\n";
+static const CHAR APLAY_RSP[] = "\r\n#APLAY: 1,\"a.wav\"\r\n\r\nOK\r\n";
+static const CHAR CREG_RSP[] = "\r\n+CREG: 2,1,\"00C3\",\"0000A13B\",7\r\n\r\nOK\r\n";
+
+/* Local function prototypes ====================================================================*/
+static void check(BOOLEAN ok, const CHAR *what, UINT32 line);
+static void test_csq(void);
+static void test_gpio(void);
+static void test_aplay(void);
+static void test_creg(void);
+static void test_malformed(void);
+static void decode_all(const CHAR *rsp);
+static void fuzz(UINT32 n);
+static void bench(UINT32 n);
+
+/* Static functions =============================================================================*/
+static void check(BOOLEAN ok, const CHAR *what, UINT32 line)
+{
+  if(!ok)
+  {
+    printf("FAIL line %u: %s\n", line, what);
+    failures++;
+  }
+}
+
+static void test_csq(void)
+{
+  AT_CSQ_T csq;
+
+  CHECK(at_parse_csq(CSQ_RSP, &csq));
+  CHECK(csq.rssi == 21 && csq.ber == 99);
+  CHECK(!at_parse_csq("\r\nOK\r\n", &csq));
+  CHECK(csq.rssi == AT_PARSE_NONE && csq.ber == AT_PARSE_NONE);
+}
+
+static void test_gpio(void)
+{
+  AT_GPIO_T gpio;
+
+  /* The echo line comes first and must be skipped */
+  CHECK(at_parse_gpio(GPIO_RSP, &gpio));
+  CHECK(gpio.dir == 1 && gpio.stat == 0);
+}
+
+static void test_aplay(void)
+{
+  AT_APLAY_T aplay;
+
+  CHECK(at_parse_aplay(APLAY_RSP, &aplay));
+  CHECK(aplay.status == 1 && STR_IS(aplay.file, "a.wav"));
+
+  /* Missing trailing field: the status alone is enough */
+  CHECK(at_parse_aplay("\r\n#APLAY: 0\r\n\r\nOK\r\n", &aplay));
+  CHECK(aplay.status == 0 && aplay.file.p == NULL && aplay.file.len == 0);
+}
+
+static void test_creg(void)
+{
+  AT_CREG_T creg;
+
+  /* Read form, with <n> */
+  CHECK(at_parse_creg(CREG_RSP, &creg));
+  CHECK(creg.n == 2 && creg.stat == 1 && creg.act == 7);
+  CHECK(STR_IS(creg.lac, "00C3") && STR_IS(creg.ci, "0000A13B"));
+
+  /* Read form without the location */
+  CHECK(at_parse_creg("\r\n+CREG: 0,5\r\n\r\nOK\r\n", &creg));
+  CHECK(creg.n == 0 && creg.stat == 5 && creg.lac.p == NULL && creg.act == AT_PARSE_NONE);
+
+  /* URC forms, without <n> */
+  CHECK(at_parse_creg("\r\n+CREG: 1,\"00C3\",\"A13B\"\r\n", &creg));
+  CHECK(creg.n == AT_PARSE_NONE && creg.stat == 1);
+  CHECK(STR_IS(creg.lac, "00C3") && STR_IS(creg.ci, "A13B") && creg.act == AT_PARSE_NONE);
+  CHECK(at_parse_creg("\r\n+CREG: 5\r\n", &creg));
+  CHECK(creg.n == AT_PARSE_NONE && creg.stat == 5);
+}
+
+static void test_malformed(void)
+{
+  AT_CSQ_T csq;
+  AT_APLAY_T aplay;
+  AT_CREG_T creg;
+
+  /* 9 digits fit, 10 would overflow */
+  CHECK(at_parse_csq("+CSQ: 999999999,0\r\n", &csq) && csq.rssi == 999999999);
+  CHECK(!at_parse_csq("+CSQ: 9999999999,0\r\n", &csq));
+  CHECK(at_parse_csq("+CSQ: -5,+3\r\n", &csq) && csq.rssi == -5 && csq.ber == 3);
+
+  /* Unterminated quotes, on the last line or before the next one */
+  CHECK(!at_parse_aplay("#APLAY: 1,\"a.wav", &aplay));
+  CHECK(!at_parse_aplay("#APLAY: 1,\"a.wav\r\n\"\r\nOK\r\n", &aplay));
+  CHECK(!at_parse_creg("+CREG: 2,1,\"00C3\r\n", &creg));
+
+  CHECK(!at_parse_csq("+CSQ: x,1\r\n", &csq));
+  CHECK(!at_parse_csq("+CSQ: 21;99\r\n", &csq));
+  CHECK(!at_parse_csq("+CSQ: \r\n", &csq));
+  CHECK(!at_parse_csq("\r\nERROR\r\n", &csq));
+  CHECK(!at_parse_csq("", &csq));
+  CHECK(at_parse_line(NULL, "+CSQ:", NULL, 0, &csq) == -1);
+}
+
+static void decode_all(const CHAR *rsp)
+{
+  AT_CSQ_T csq;
+  AT_GPIO_T gpio;
+  AT_APLAY_T aplay;
+  AT_CREG_T creg;
+
+  (void)at_parse_csq(rsp, &csq);
+  (void)at_parse_gpio(rsp, &gpio);
+  (void)at_parse_creg(rsp, &creg);
+  if(at_parse_aplay(rsp, &aplay) && aplay.file.p)
+  {
+    /* The string must lie inside the response */
+    CHECK(aplay.file.p >= rsp && aplay.file.p + aplay.file.len <= rsp + strlen(rsp));
+  }
+}
+
+/* Random lines built from the characters the decoders care about, after a real prefix */
+static void fuzz(UINT32 n)
+{
+  static const CHAR *prefixes[] = { "+CSQ: ", "#GPIO: ", "#APLAY: ", "+CREG: ", "" };
+  static const CHAR alphabet[] = "0123456789,\"\r\n -+x";
+  CHAR line[FUZZ_LINE_MAX];
+  UINT32 i, len, k;
+
+  srand(1);
+  for(i = 0; i < n; i++)
+  {
+    len = (UINT32)snprintf(line, sizeof(line), "%s", prefixes[rand() % 5]);
+    k = len + (UINT32)(rand() % (FUZZ_LINE_MAX - len));
+    while(len < k)
+    {
+      line[len++] = alphabet[rand() % (sizeof(alphabet) - 1)];
+    }
+    line[len] = '\0';
+    decode_all(line);
+  }
+  printf("fuzz: %u lines\n", n);
+}
+
+static void bench(UINT32 n)
+{
+  static const CHAR *samples[] = { CSQ_RSP, GPIO_RSP, APLAY_RSP, CREG_RSP };
+  static const CHAR *names[] = { "csq", "gpio", "aplay", "creg" };
+  struct timespec t0, t1;
+  AT_CSQ_T csq;
+  AT_GPIO_T gpio;
+  AT_APLAY_T aplay;
+  AT_CREG_T creg;
+  UINT32 i, s, ok = 0;
+  double ns;
+
+  for(s = 0; s < 4; s++)
+  {
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for(i = 0; i < n; i++)
+    {
+      switch(s)
+      {
+      case 0: ok += at_parse_csq(samples[s], &csq); break;
+      case 1: ok += at_parse_gpio(samples[s], &gpio); break;
+      case 2: ok += at_parse_aplay(samples[s], &aplay); break;
+      default: ok += at_parse_creg(samples[s], &creg); break;
+      }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    ns = (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+    printf("bench %-6s %8.1f ns/decode\n", names[s], ns / n);
+  }
+  CHECK(ok == 4 * n);
+}
+
+/* Global functions =============================================================================*/
+#ifdef AT_PARSE_LIBFUZZER
+int LLVMFuzzerTestOneInput(const UINT8 *data, size_t size)
+{
+  CHAR line[256];
+
+  if(size >= sizeof(line))
+  {
+    return 0;
+  }
+  memcpy(line, data, size);
+  line[size] = '\0';
+  decode_all(line);
+  return 0;
+}
+#else
+int main(int argc, char **argv)
+{
+  UINT32 n = (argc > 2) ? (UINT32)strtoul(argv[2], NULL, 0) : 0;
+
+  if(argc > 1 && strcmp(argv[1], "fuzz") == 0)
+  {
+    fuzz(n ? n : 1000000);
+  }
+  else if(argc > 1 && strcmp(argv[1], "bench") == 0)
+  {
+    bench(n ? n : 1000000);
+  }
+  else
+  {
+    test_csq();
+    test_gpio();
+    test_aplay();
+    test_creg();
+    test_malformed();
+  }
+  printf("%s\n", failures ? "FAILED" : "OK");
+  return failures ? 1 : 0;
+}
+#endif
@@ -0,0 +1,50 @@
+#!/usr/bin/env python3
+"""Convert an azx_trace dump to Chrome trace / Perfetto JSON.
+
+Usage: trace2chrome.py <dump.txt> [out.json]
+
+The dump is produced on the module by azx_trace_dump_to_file() or
+azx_trace_dump_to_usb(). Open the result in chrome://tracing or
+https://ui.perfetto.dev.
+"""
+import json
+import sys
+
+
+def convert(lines):
+    events = []
+    threads = {}
+    for line in lines:
+        fields = line.rstrip("\r\n").split("\t")
+        if len(fields) != 6:
+            continue
+        tid, task, ts, ph, name, arg = fields
+        tid = int(tid)
+        ts = int(ts)
+        threads[tid] = task
+        ev = {"name": name, "ph": ph, "ts": ts,
+              "pid": 1, "tid": tid, "args": {"arg": int(arg)}}
+        if ph == "i":
+            ev["s"] = "t"
+        events.append(ev)
+
+    events.sort(key=lambda e: e["ts"])
+    for tid, task in threads.items():
+        events.append({"name": "thread_name", "ph": "M", "pid": 1, "tid": tid,
+                       "args": {"name": task or "task%d" % tid}})
+    return {"traceEvents": events, "displayTimeUnit": "ms"}
+
+
+def main():
+    if len(sys.argv) < 2:
+        sys.stderr.write(__doc__)
+        return 1
+    with open(sys.argv[1]) as f:
+        trace = convert(f)
+    out = open(sys.argv[2], "w") if len(sys.argv) > 2 else sys.stdout
+    json.dump(trace, out)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())